@@ -0,0 +1,535 @@
+/*
+  ==============================================================================
+
+    AudioCallbackProfiler.h
+    Created: 19 Oct 2026 10:12:40am
+    Author:  Samuel Chadri
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Measures how long each audio callback takes against its block budget
+    (numSamples / sampleRate). Everything the audio thread touches is a relaxed
+    atomic with a single writer, so recording a block costs a couple of
+    high-resolution tick reads and a handful of stores.
+*/
+class AudioCallbackProfiler
+{
+public:
+    enum Stage
+    {
+        engineGraph,
+        metronome,
+        synth,
+        numStages
+    };
+
+    // Each bin covers 1/binsPerBudget of the budget, the last bin catches everything above.
+    static constexpr int binsPerBudget = 32;
+    static constexpr int numBins = binsPerBudget * 2;
+    static constexpr double nearMissThreshold = 0.8;
+
+    static const char* getStageName (int stage)
+    {
+        switch (stage)
+        {
+            case engineGraph:   return "Engine";
+            case metronome:     return "Metronome";
+            case synth:         return "Synth";
+            default:            return "";
+        }
+    }
+
+    void prepare (double newSampleRate)
+    {
+        sampleRate.store (newSampleRate, std::memory_order_relaxed);
+    }
+
+    void reset()
+    {
+        resetRequested.store (true, std::memory_order_release);
+    }
+
+    //==============================================================================
+    struct ScopedCallback
+    {
+        ScopedCallback (AudioCallbackProfiler& p, int numSamplesToUse) noexcept
+            : profiler (p), numSamples (numSamplesToUse), start (juce::Time::getHighResolutionTicks())
+        {
+            profiler.beginCallback();
+        }
+
+        ~ScopedCallback() noexcept
+        {
+            profiler.endCallback (juce::Time::getHighResolutionTicks() - start, numSamples);
+        }
+
+        AudioCallbackProfiler& profiler;
+        const int numSamples;
+        const juce::int64 start;
+    };
+
+    struct ScopedStage
+    {
+        ScopedStage (AudioCallbackProfiler& p, Stage s) noexcept
+            : profiler (p), stage (s), start (juce::Time::getHighResolutionTicks())
+        {
+        }
+
+        ~ScopedStage() noexcept
+        {
+            profiler.addStageTicks (stage, juce::Time::getHighResolutionTicks() - start);
+        }
+
+        AudioCallbackProfiler& profiler;
+        const Stage stage;
+        const juce::int64 start;
+    };
+
+    //==============================================================================
+    struct Snapshot
+    {
+        double sampleRate = 0.0;
+        juce::int64 numCallbacks = 0, numXruns = 0, numNearMisses = 0;
+        juce::int64 histogram[numBins] = {};
+
+        double totalLoad = 0.0;
+        double stageLoad[numStages] = {};
+
+        juce::int64 worstCallbackIndex = -1;
+        int worstNumSamples = 0;
+        double worstLoad = 0.0;
+        double worstStageLoad[numStages] = {};
+    };
+
+    Snapshot getSnapshot() const noexcept
+    {
+        Snapshot s;
+        s.sampleRate = sampleRate.load (std::memory_order_relaxed);
+        s.numCallbacks = numCallbacks.load (std::memory_order_acquire);
+        s.numXruns = numXruns.load (std::memory_order_relaxed);
+        s.numNearMisses = numNearMisses.load (std::memory_order_relaxed);
+        s.totalLoad = totalLoad.load (std::memory_order_relaxed);
+
+        for (int i = 0; i < numBins; ++i)
+            s.histogram[i] = histogram[i].load (std::memory_order_relaxed);
+
+        for (int i = 0; i < numStages; ++i)
+            s.stageLoad[i] = stageLoad[i].load (std::memory_order_relaxed);
+
+        // The worst block is written as a group, so use the sequence counter to get a consistent copy
+        for (;;)
+        {
+            auto seq = worstSequence.load (std::memory_order_acquire);
+
+            if ((seq & 1) == 0)
+            {
+                s.worstCallbackIndex = worstCallbackIndex.load (std::memory_order_relaxed);
+                s.worstNumSamples = worstNumSamples.load (std::memory_order_relaxed);
+                s.worstLoad = worstLoad.load (std::memory_order_relaxed);
+
+                for (int i = 0; i < numStages; ++i)
+                    s.worstStageLoad[i] = worstStageLoad[i].load (std::memory_order_relaxed);
+
+                std::atomic_thread_fence (std::memory_order_acquire);
+
+                if (worstSequence.load (std::memory_order_relaxed) == seq)
+                    break;
+            }
+
+            juce::Thread::yield();
+        }
+
+        return s;
+    }
+
+private:
+    //==============================================================================
+    void beginCallback() noexcept
+    {
+        if (resetRequested.exchange (false, std::memory_order_acquire))
+            clear();
+
+        for (auto& t : currentStageTicks)
+            t = 0;
+    }
+
+    void addStageTicks (Stage stage, juce::int64 ticks) noexcept
+    {
+        currentStageTicks[stage] += ticks;
+    }
+
+    void endCallback (juce::int64 ticks, int numSamples) noexcept
+    {
+        auto rate = sampleRate.load (std::memory_order_relaxed);
+
+        if (rate <= 0.0 || numSamples <= 0)
+            return;
+
+        const double budget = numSamples / rate;
+        const double load = juce::Time::highResolutionTicksToSeconds (ticks) / budget;
+
+        auto bin = juce::jlimit (0, numBins - 1, (int) (load * binsPerBudget));
+        histogram[bin].store (histogram[bin].load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        if (load >= 1.0)
+            numXruns.store (numXruns.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        else if (load >= nearMissThreshold)
+            numNearMisses.store (numNearMisses.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        totalLoad.store (totalLoad.load (std::memory_order_relaxed) + load, std::memory_order_relaxed);
+
+        double currentStageLoad[numStages];
+
+        for (int i = 0; i < numStages; ++i)
+        {
+            currentStageLoad[i] = juce::Time::highResolutionTicksToSeconds (currentStageTicks[i]) / budget;
+            stageLoad[i].store (stageLoad[i].load (std::memory_order_relaxed) + currentStageLoad[i], std::memory_order_relaxed);
+        }
+
+        auto index = numCallbacks.load (std::memory_order_relaxed);
+
+        if (load > worstLoad.load (std::memory_order_relaxed))
+        {
+            worstSequence.fetch_add (1, std::memory_order_acq_rel);
+            worstCallbackIndex.store (index, std::memory_order_relaxed);
+            worstNumSamples.store (numSamples, std::memory_order_relaxed);
+            worstLoad.store (load, std::memory_order_relaxed);
+
+            for (int i = 0; i < numStages; ++i)
+                worstStageLoad[i].store (currentStageLoad[i], std::memory_order_relaxed);
+
+            worstSequence.fetch_add (1, std::memory_order_release);
+        }
+
+        numCallbacks.store (index + 1, std::memory_order_release);
+    }
+
+    void clear() noexcept
+    {
+        for (auto& b : histogram)
+            b.store (0, std::memory_order_relaxed);
+
+        for (auto& l : stageLoad)
+            l.store (0.0, std::memory_order_relaxed);
+
+        numXruns.store (0, std::memory_order_relaxed);
+        numNearMisses.store (0, std::memory_order_relaxed);
+        totalLoad.store (0.0, std::memory_order_relaxed);
+
+        worstSequence.fetch_add (1, std::memory_order_acq_rel);
+        worstCallbackIndex.store (-1, std::memory_order_relaxed);
+        worstNumSamples.store (0, std::memory_order_relaxed);
+        worstLoad.store (0.0, std::memory_order_relaxed);
+
+        for (auto& l : worstStageLoad)
+            l.store (0.0, std::memory_order_relaxed);
+
+        worstSequence.fetch_add (1, std::memory_order_release);
+        numCallbacks.store (0, std::memory_order_release);
+    }
+
+    //==============================================================================
+    std::atomic<double> sampleRate { 0.0 };
+    std::atomic<bool> resetRequested { false };
+
+    std::atomic<juce::int64> numCallbacks { 0 }, numXruns { 0 }, numNearMisses { 0 };
+    std::atomic<juce::int64> histogram[numBins] = {};
+    std::atomic<double> totalLoad { 0.0 };
+    std::atomic<double> stageLoad[numStages] = {};
+
+    std::atomic<juce::uint32> worstSequence { 0 };
+    std::atomic<juce::int64> worstCallbackIndex { -1 };
+    std::atomic<int> worstNumSamples { 0 };
+    std::atomic<double> worstLoad { 0.0 };
+    std::atomic<double> worstStageLoad[numStages] = {};
+
+    // Only touched by the audio thread
+    juce::int64 currentStageTicks[numStages] = {};
+};
+
+//==============================================================================
+/*
+    Wraps one of the mixer's inputs so its share of the callback gets
+    accounted to a profiler stage.
+*/
+class ProfiledAudioSource : public juce::AudioSource
+{
+public:
+    ProfiledAudioSource (AudioCallbackProfiler& p, AudioCallbackProfiler::Stage s, juce::AudioSource& source)
+        : profiler (p), stage (s), input (source)
+    {
+    }
+
+    void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override
+    {
+        input.prepareToPlay (samplesPerBlockExpected, sampleRate);
+    }
+
+    void releaseResources() override
+    {
+        input.releaseResources();
+    }
+
+    void getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill) override
+    {
+        const AudioCallbackProfiler::ScopedStage scopedStage (profiler, stage);
+        input.getNextAudioBlock (bufferToFill);
+    }
+
+private:
+    AudioCallbackProfiler& profiler;
+    const AudioCallbackProfiler::Stage stage;
+    juce::AudioSource& input;
+};
+
+//==============================================================================
+/*
+    Polls the profiler off the audio thread, turns the running totals into
+    per-interval figures for the meter, logs any new worst-case block and
+    writes reports for offline analysis.
+*/
+class AudioCallbackStatsThread : private juce::Thread
+{
+public:
+    struct Stats
+    {
+        double averageLoad = 0.0, peakBinLoad = 0.0;
+        double stageLoad[AudioCallbackProfiler::numStages] = {};
+        juce::int64 numXruns = 0, numNearMisses = 0, numCallbacks = 0;
+        double worstLoad = 0.0;
+    };
+
+    AudioCallbackStatsThread (const AudioCallbackProfiler& p)
+        : juce::Thread ("Audio Callback Stats"), profiler (p)
+    {
+        startThread (2);
+    }
+
+    ~AudioCallbackStatsThread() override
+    {
+        stopThread (2000);
+    }
+
+    Stats getLatestStats() const
+    {
+        const juce::SpinLock::ScopedLockType sl (statsLock);
+        return latest;
+    }
+
+    juce::Result exportToFile (const juce::File& file) const
+    {
+        auto s = profiler.getSnapshot();
+
+        juce::MemoryOutputStream out;
+        out << "sampleRate," << s.sampleRate << "\n"
+            << "callbacks," << s.numCallbacks << "\n"
+            << "xruns," << s.numXruns << "\n"
+            << "nearMisses," << s.numNearMisses << "\n"
+            << "averageLoad," << (s.numCallbacks > 0 ? s.totalLoad / (double) s.numCallbacks : 0.0) << "\n";
+
+        for (int i = 0; i < AudioCallbackProfiler::numStages; ++i)
+            out << "averageLoad" << AudioCallbackProfiler::getStageName (i) << ","
+                << (s.numCallbacks > 0 ? s.stageLoad[i] / (double) s.numCallbacks : 0.0) << "\n";
+
+        out << "worstCallback," << s.worstCallbackIndex << "\n"
+            << "worstNumSamples," << s.worstNumSamples << "\n"
+            << "worstLoad," << s.worstLoad << "\n";
+
+        for (int i = 0; i < AudioCallbackProfiler::numStages; ++i)
+            out << "worstLoad" << AudioCallbackProfiler::getStageName (i) << "," << s.worstStageLoad[i] << "\n";
+
+        out << "\nbinStartLoad,binEndLoad,count\n";
+
+        for (int i = 0; i < AudioCallbackProfiler::numBins; ++i)
+            out << i / (double) AudioCallbackProfiler::binsPerBudget << ","
+                << (i + 1) / (double) AudioCallbackProfiler::binsPerBudget << ","
+                << s.histogram[i] << "\n";
+
+        if (! file.replaceWithText (out.toString()))
+            return juce::Result::fail ("Unable to write timing report to: " + file.getFullPathName());
+
+        return juce::Result::ok();
+    }
+
+private:
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            update();
+            wait (250);
+        }
+    }
+
+    void update()
+    {
+        auto s = profiler.getSnapshot();
+
+        // The profiler was reset since the last poll
+        if (s.numCallbacks < last.numCallbacks)
+            last = {};
+
+        Stats newStats;
+        auto numNew = s.numCallbacks - last.numCallbacks;
+
+        if (numNew > 0)
+        {
+            newStats.averageLoad = (s.totalLoad - last.totalLoad) / (double) numNew;
+
+            for (int i = 0; i < AudioCallbackProfiler::numStages; ++i)
+                newStats.stageLoad[i] = (s.stageLoad[i] - last.stageLoad[i]) / (double) numNew;
+
+            for (int i = AudioCallbackProfiler::numBins; --i >= 0;)
+            {
+                if (s.histogram[i] != last.histogram[i])
+                {
+                    newStats.peakBinLoad = (i + 1) / (double) AudioCallbackProfiler::binsPerBudget;
+                    break;
+                }
+            }
+        }
+
+        newStats.numXruns = s.numXruns;
+        newStats.numNearMisses = s.numNearMisses;
+        newStats.numCallbacks = s.numCallbacks;
+        newStats.worstLoad = s.worstLoad;
+
+        if (s.worstCallbackIndex >= 0 && s.worstCallbackIndex != last.worstCallbackIndex)
+        {
+            juce::String message;
+            message << "Worst audio callback so far: #" << s.worstCallbackIndex
+                    << ", " << s.worstNumSamples << " samples, "
+                    << juce::String (s.worstLoad * 100.0, 1) << "% of budget (";
+
+            for (int i = 0; i < AudioCallbackProfiler::numStages; ++i)
+                message << (i > 0 ? ", " : "") << AudioCallbackProfiler::getStageName (i)
+                        << " " << juce::String (s.worstStageLoad[i] * 100.0, 1) << "%";
+
+            juce::Logger::writeToLog (message << ")");
+        }
+
+        last = s;
+
+        const juce::SpinLock::ScopedLockType sl (statsLock);
+        latest = newStats;
+    }
+
+    const AudioCallbackProfiler& profiler;
+    AudioCallbackProfiler::Snapshot last;
+
+    juce::SpinLock statsLock;
+    Stats latest;
+};
+
+//==============================================================================
+class CpuMeterComponent : public juce::Component, private juce::Timer
+{
+public:
+    CpuMeterComponent (AudioCallbackProfiler& p)
+        : profiler (p), statsThread (p)
+    {
+        updateHelpText();
+        startTimerHz (10);
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+        auto r = getLocalBounds().toFloat();
+
+        g.setColour (juce::Colours::black);
+        g.fillRect (r);
+
+        auto bar = r.reduced (1.0f);
+        auto loadToWidth = [&] (double load) { return bar.getWidth() * (float) juce::jlimit (0.0, 1.0, load); };
+
+        // Stacked per-source cost, then whatever the callback spent outside the sources
+        float x = bar.getX();
+        const juce::Colour stageColours[] = { juce::Colours::seagreen, juce::Colours::steelblue, juce::Colours::orchid };
+
+        for (int i = 0; i < AudioCallbackProfiler::numStages; ++i)
+        {
+            auto w = loadToWidth (stats.stageLoad[i]);
+            g.setColour (stageColours[i]);
+            g.fillRect (x, bar.getY(), w, bar.getHeight());
+            x += w;
+        }
+
+        g.setColour (juce::Colours::grey);
+        g.fillRect (x, bar.getY(), juce::jmax (0.0f, loadToWidth (stats.averageLoad) - (x - bar.getX())), bar.getHeight());
+
+        g.setColour (stats.peakBinLoad >= 1.0 ? juce::Colours::red : juce::Colours::yellow);
+        g.fillRect (bar.getX() + loadToWidth (stats.peakBinLoad) - 1.0f, bar.getY(), 2.0f, bar.getHeight());
+
+        g.setColour (juce::Colours::white);
+        g.setFont (juce::jmin (14.0f, r.getHeight() * 0.8f));
+        g.drawText ("CPU " + juce::String (stats.averageLoad * 100.0, 1) + "%"
+                      + "   xruns " + juce::String (stats.numXruns)
+                      + "   near " + juce::String (stats.numNearMisses),
+                    getLocalBounds().reduced (4, 0), juce::Justification::centredLeft);
+    }
+
+    void mouseDown (const juce::MouseEvent&) override
+    {
+        juce::PopupMenu m;
+        m.addItem ("Reset", [this] { profiler.reset(); });
+        m.addItem ("Export Timing Report...", [this] { exportReport(); });
+        m.addItem ("Heaviest Track Plugins...", onShowTopTracks != nullptr, false, [this] { onShowTopTracks(); });
+        m.showMenuAsync ({});
+    }
+
+    /** Shows the tracks costing the most, if whoever owns the meter knows about them. */
+    std::function<void()> onShowTopTracks;
+
+private:
+    void timerCallback() override
+    {
+        stats = statsThread.getLatestStats();
+        updateHelpText();
+        repaint();
+    }
+
+    void updateHelpText()
+    {
+        juce::String tip;
+        tip << "Worst block: " << juce::String (stats.worstLoad * 100.0, 1) << "% of budget";
+
+        for (int i = 0; i < AudioCallbackProfiler::numStages; ++i)
+            tip << "\n" << AudioCallbackProfiler::getStageName (i) << ": " << juce::String (stats.stageLoad[i] * 100.0, 1) << "%";
+
+        setHelpText (tip);
+    }
+
+    void exportReport()
+    {
+        chooser = std::make_unique<juce::FileChooser> ("Export audio callback timing...",
+                                                       juce::File::getSpecialLocation (juce::File::userDocumentsDirectory)
+                                                           .getChildFile ("AudioCallbackTiming.csv"),
+                                                       "*.csv");
+
+        chooser->launchAsync (juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles,
+                              [this] (const juce::FileChooser& fc)
+                              {
+                                  auto f = fc.getResult();
+
+                                  if (f == juce::File())
+                                      return;
+
+                                  auto res = statsThread.exportToFile (f);
+
+                                  if (! res)
+                                      DBG(res.getErrorMessage());
+                              });
+    }
+
+    AudioCallbackProfiler& profiler;
+    AudioCallbackStatsThread statsThread;
+    AudioCallbackStatsThread::Stats stats;
+    std::unique_ptr<juce::FileChooser> chooser;
+};
@@ -53,9 +53,32 @@ void EngineAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo &bu
     audioInterface.processBlock(*bufferToFill.buffer, incomingMidi);
 }
 
-tracktion_engine::Edit & EngineAudioSource::getStepEdit()
+static const juce::String stepTrackName("Step Sequencer");
+
+tracktion_engine::AudioTrack* EngineAudioSource::getStepTrack()
+{
+    if(edit == nullptr)
+        return nullptr;
+    
+    for(auto track : tracktion_engine::getAudioTracks(*edit))
+        if(track->getName() == stepTrackName)
+            return track;
+    
+    return nullptr;
+}
+
+tracktion_engine::AudioTrack* EngineAudioSource::ensureStepTrack()
 {
-    return stepEdit;
+    if(edit == nullptr)
+        return nullptr;
+    
+    if(auto track = getStepTrack())
+        return track;
+    
+    // Appended after the input tracks so it never picks up a live input assignment
+    auto track = getOrInsertAudioTrackAt(*edit, tracktion_engine::getAudioTracks(*edit).size());
+    track->setName(stepTrackName);
+    return track;
 }
 
 inline tracktion_engine::Edit& EngineAudioSource::getEdit(){
@@ -64,7 +87,11 @@ inline tracktion_engine::Edit& EngineAudioSource::getEdit(){
 
 void EngineAudioSource::setEdit(std::unique_ptr<tracktion_engine::Edit> new_edit)
 {
+    tempoMap.reset();
     edit = std::move(new_edit);
+    
+    if(edit != nullptr)
+        tempoMap = std::make_unique<TempoMapIndex>(edit->tempoSequence);
 }
 
 void EngineAudioSource::setSynthSource(SynthAudioSource *synthSource)
@@ -72,12 +99,56 @@ void EngineAudioSource::setSynthSource(SynthAudioSource *synthSource)
     synthSourcePtr = synthSource;
 }
 
+// The map is committed before the live flag is cleared, so nothing following the
+// live tempo hands back to a map that hasn't got it yet
+void EngineAudioSource::setTempo(double bpm, bool commitNow)
+{
+    if(commitNow && edit != nullptr)
+        edit->tempoSequence.getTempos()[0]->setBpm(bpm);
+    
+    realtimeTempo->setTargetBpm(bpm, ! commitNow);
+}
+
+RealtimeTempo& EngineAudioSource::getRealtimeTempo()
+{
+    return *realtimeTempo;
+}
+
+TempoMapIndex& EngineAudioSource::getTempoMap()
+{
+    return *tempoMap;
+}
+
 
 tracktion_engine::Engine& EngineAudioSource::getEngine()
 {
     return engine;
 }
 
+GraphEngineBehaviour& EngineAudioSource::getGraphBehaviour()
+{
+    return static_cast<GraphEngineBehaviour&>(engine.getEngineBehaviour());
+}
+
+void EngineAudioSource::applyGraphSettings()
+{
+    if(edit == nullptr)
+        return;
+    
+    auto& transport = edit->getTransport();
+    
+    if(! transport.isPlayContextActive())
+        return;
+    
+    const bool wasPlaying = transport.isPlaying();
+    transport.stop(false, false);
+    transport.freePlaybackContext();
+    transport.ensureContextAllocated();
+    
+    if(wasPlaying)
+        transport.play(false);
+}
+
 void EngineAudioSource::releaseResources()
 {
     
@@ -11,6 +11,9 @@
 #pragma once
 #include <JuceHeader.h>
 #include "SynthAudioSource.h"
+#include "GraphSettings.h"
+#include "RealtimeTempo.h"
+#include "../includes/common/TempoMapIndex.h"
 
 class EngineAudioSource : public juce::AudioSource 
 {
@@ -25,10 +28,19 @@ public:
     
     virtual inline tracktion_engine::Edit& getEdit();
     
-    tracktion_engine::Edit& getStepEdit();
+    /** The track the step sequencer's clip and sampler live on, or nullptr if there isn't one yet. */
+    tracktion_engine::AudioTrack* getStepTrack();
+    
+    /** Returns the step track, appending it to the edit if it doesn't exist. */
+    tracktion_engine::AudioTrack* ensureStepTrack();
     
     tracktion_engine::Engine& getEngine();
     
+    GraphEngineBehaviour& getGraphBehaviour();
+    
+    /** Rebuilds the playback contexts so a new thread count/strategy takes effect. */
+    void applyGraphSettings();
+    
     tracktion_engine::AudioTrack* getOrInsertAudioTrackAt(tracktion_engine::Edit &edit, int index);
     
     void setupOutputs ();
@@ -37,6 +49,18 @@ public:
     
     void setSynthSource(SynthAudioSource * synthSource);
     
+    /** Sets the Edit's tempo. With commitNow false (e.g. during a slider drag) it's
+        only published to RealtimeTempo, which the metronome and step player ramp
+        to on the audio thread, and the tempo map is left alone until a call with
+        commitNow true.
+    */
+    void setTempo(double bpm, bool commitNow);
+    
+    RealtimeTempo& getRealtimeTempo();
+    
+    /** Cached tempo map of the current edit, safe to query from any thread. */
+    TempoMapIndex& getTempoMap();
+    
     template<typename Function>
     void callFunctionOnMessageThread (Function&& func)
     {
@@ -61,12 +85,13 @@ public:
     bool midiEnginePlayback = false;
     //
 private:
-    tracktion_engine::Engine engine {ProjectInfo::projectName};
+    tracktion_engine::Engine engine {ProjectInfo::projectName, nullptr, std::make_unique<GraphEngineBehaviour>()};
     std::unique_ptr<tracktion_engine::Edit> edit;
-    tracktion_engine::Edit stepEdit { engine, tracktion_engine::createEmptyEdit (engine), tracktion_engine::Edit::forEditing, nullptr, 0};
+    std::unique_ptr<TempoMapIndex> tempoMap;
     tracktion_engine::HostedAudioDeviceInterface& audioInterface;
     juce::MidiKeyboardState& keyboardState;
     SynthAudioSource * synthSourcePtr;
+    juce::SharedResourcePointer<RealtimeTempo> realtimeTempo;
     
     
     
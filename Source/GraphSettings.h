@@ -0,0 +1,437 @@
+/*
+  ==============================================================================
+
+    GraphSettings.h
+    Created: 19 Oct 2026 2:21:08pm
+    Author:  Samuel Chadri
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Thread count and pool strategy for tracktion_graph processing. The best
+    choice depends on the CPU, so it's stored per machine in the app settings.
+*/
+struct GraphSettings
+{
+    using Strategy = tracktion_graph::ThreadPoolStrategy;
+
+    int numThreads = 0;     // Total audio threads including the device callback, 0 means the engine default
+    Strategy strategy = Strategy::realTime;
+
+    static juce::Array<Strategy> getStrategies()
+    {
+        return { Strategy::realTime, Strategy::semaphore, Strategy::hybrid };
+    }
+
+    static juce::String getStrategyName (Strategy s)
+    {
+        switch (s)
+        {
+            case Strategy::realTime:    return "Spin";
+            case Strategy::semaphore:   return "Semaphore";
+            case Strategy::hybrid:      return "Hybrid";
+            default:                    return "Other";
+        }
+    }
+
+    juce::String getDescription() const
+    {
+        if (numThreads <= 0)
+            return "Default threads, " + getStrategyName (strategy);
+
+        return juce::String (numThreads) + (numThreads == 1 ? " thread" : " threads")
+                + (numThreads > 1 ? ", " + getStrategyName (strategy) : juce::String());
+    }
+
+    //==============================================================================
+    static juce::String getMachineDescription()
+    {
+        return juce::SystemStats::getComputerName() + " / " + juce::SystemStats::getCpuVendor()
+                + " / " + juce::String (juce::SystemStats::getNumCpus()) + " cores";
+    }
+
+    static juce::String getMachineKey()
+    {
+        return "graph_" + juce::String::toHexString (getMachineDescription().hashCode64());
+    }
+
+    static std::unique_ptr<juce::PropertiesFile> openPropertiesFile()
+    {
+        juce::PropertiesFile::Options o;
+        o.applicationName = ProjectInfo::projectName;
+        o.folderName = ProjectInfo::projectName;
+        o.filenameSuffix = ".settings";
+        o.osxLibrarySubFolder = "Application Support";
+
+        return std::make_unique<juce::PropertiesFile> (o);
+    }
+
+    /** Returns a default constructed GraphSettings if nothing has been saved on this machine yet. */
+    static GraphSettings loadForThisMachine()
+    {
+        GraphSettings s;
+
+        if (auto props = openPropertiesFile())
+        {
+            if (auto xml = props->getXmlValue (getMachineKey()))
+            {
+                s.numThreads = juce::jlimit (0, juce::SystemStats::getNumCpus(), xml->getIntAttribute ("numThreads"));
+                s.strategy = (Strategy) xml->getIntAttribute ("strategy", (int) Strategy::realTime);
+            }
+        }
+
+        return s;
+    }
+
+    void saveForThisMachine (const juce::String& benchmarkReport = {}) const
+    {
+        if (auto props = openPropertiesFile())
+        {
+            juce::XmlElement xml ("GRAPHSETTINGS");
+            xml.setAttribute ("machine", getMachineDescription());
+            xml.setAttribute ("numThreads", numThreads);
+            xml.setAttribute ("strategy", (int) strategy);
+
+            if (benchmarkReport.isNotEmpty())
+            {
+                xml.setAttribute ("calibrated", juce::Time::getCurrentTime().toISO8601 (true));
+                xml.setAttribute ("report", benchmarkReport);
+            }
+
+            props->setValue (getMachineKey(), &xml);
+            props->saveIfNeeded();
+        }
+    }
+};
+
+//==============================================================================
+/*
+    Hands the saved thread count to the engine. tracktion only reads it when a
+    playback context or render graph is created, so changing it means
+    reallocating the Edit's context (see EngineAudioSource::applyGraphSettings).
+*/
+class GraphEngineBehaviour : public tracktion_engine::EngineBehaviour
+{
+public:
+    GraphEngineBehaviour()
+    {
+        setSettings (GraphSettings::loadForThisMachine());
+    }
+
+    int getNumberOfCPUsToUseForAudio() override
+    {
+        if (auto n = numThreads.load (std::memory_order_relaxed); n > 0)
+            return n;
+
+        return tracktion_engine::EngineBehaviour::getNumberOfCPUsToUseForAudio();
+    }
+
+    void setSettings (const GraphSettings& newSettings)
+    {
+        numThreads.store (newSettings.numThreads, std::memory_order_relaxed);
+        tracktion_engine::EditPlaybackContext::setThreadPoolStrategy ((int) newSettings.strategy);
+    }
+
+    /** What's been asked for, so numThreads is still 0 when it's left to the engine. */
+    GraphSettings getSettings()
+    {
+        GraphSettings s;
+        s.numThreads = numThreads.load (std::memory_order_relaxed);
+        s.strategy = (GraphSettings::Strategy) tracktion_engine::EditPlaybackContext::getThreadPoolStrategy();
+        return s;
+    }
+
+private:
+    std::atomic<int> numThreads { 0 };
+};
+
+//==============================================================================
+/*
+    Renders a section of an Edit offline for each thread count/strategy pair
+    and times it. Offline rendering builds its graph with the same engine
+    settings as playback, so the fastest render is the best live setting too.
+
+    The Edit's playback context is released for the duration, so live inputs
+    and playback aren't competing for the same cores (and glitching) while the
+    renders are timed. It's reallocated, and the original settings put back,
+    when the benchmark finishes or is cancelled.
+*/
+class GraphBenchmark : public juce::ThreadWithProgressWindow
+{
+public:
+    struct Result
+    {
+        GraphSettings settings;
+        double seconds = 0.0;
+    };
+
+    GraphBenchmark (tracktion_engine::Edit& e, GraphEngineBehaviour& b,
+                    std::function<void (const GraphBenchmark&)> onFinished)
+        : juce::ThreadWithProgressWindow ("Calibrating audio threads...", true, true),
+          edit (e), behaviour (b), originalSettings (b.getSettings()), finishedCallback (std::move (onFinished))
+    {
+        auto& transport = edit.getTransport();
+        hadPlaybackContext = transport.isPlayContextActive();
+
+        transport.stop (false, false);
+        transport.freePlaybackContext();
+    }
+
+    static juce::Array<GraphSettings> getCandidates()
+    {
+        // Powers of two up to the core count, plus the core count itself
+        const auto maxThreads = juce::SystemStats::getNumCpus();
+        juce::Array<int> threadCounts;
+
+        for (int n = 2; n < maxThreads; n *= 2)
+            threadCounts.add (n);
+
+        if (maxThreads > 1)
+            threadCounts.add (maxThreads);
+
+        // The strategy only matters once there are worker threads
+        juce::Array<GraphSettings> candidates { GraphSettings { 1 } };
+
+        for (auto n : threadCounts)
+            for (auto s : GraphSettings::getStrategies())
+                candidates.add ({ n, s });
+
+        return candidates;
+    }
+
+    void run() override
+    {
+        const auto candidates = getCandidates();
+
+        for (int i = 0; i < candidates.size(); ++i)
+        {
+            const auto& candidate = candidates.getReference (i);
+            setStatusMessage ("Measuring " + candidate.getDescription() + "...");
+            setProgress (i / (double) candidates.size());
+
+            behaviour.setSettings (candidate);
+            auto best = std::numeric_limits<double>::max();
+
+            for (int run = 0; run < numRunsPerCandidate; ++run)
+            {
+                if (threadShouldExit())
+                    return;
+
+                best = juce::jmin (best, timeRender());
+            }
+
+            results.push_back ({ candidate, best });
+        }
+    }
+
+    void threadComplete (bool userPressedCancel) override
+    {
+        behaviour.setSettings (originalSettings);
+        benchmarkFile.deleteFile();
+
+        if (hadPlaybackContext)
+            edit.getTransport().ensureContextAllocated();
+
+        if (! userPressedCancel && finishedCallback)
+            finishedCallback (*this);
+    }
+
+    const std::vector<Result>& getResults() const    { return results; }
+
+    const Result* getFastest() const
+    {
+        auto r = std::min_element (results.begin(), results.end(),
+                                   [] (auto& a, auto& b) { return a.seconds < b.seconds; });
+
+        return r != results.end() ? &*r : nullptr;
+    }
+
+    juce::String getReport() const
+    {
+        juce::String report;
+
+        for (auto& r : results)
+            report << r.settings.getDescription() << ": " << juce::String (r.seconds * 1000.0, 1) << " ms\n";
+
+        return report;
+    }
+
+private:
+    static constexpr int numRunsPerCandidate = 2;
+    static constexpr double renderLengthSeconds = 10.0;
+
+    tracktion_engine::Edit& edit;
+    GraphEngineBehaviour& behaviour;
+    const GraphSettings originalSettings;
+    bool hadPlaybackContext = false;
+    std::function<void (const GraphBenchmark&)> finishedCallback;
+    std::vector<Result> results;
+    juce::File benchmarkFile { edit.engine.getTemporaryFileManager().getTempFile ("graph_benchmark.wav") };
+
+    double timeRender()
+    {
+        std::unique_ptr<tracktion_engine::Renderer::RenderTask> task;
+
+        {
+            // The render graph is built from the Edit's state, which belongs to the message thread
+            const juce::MessageManagerLock mml (this);
+
+            if (! mml.lockWasGained())
+                return std::numeric_limits<double>::max();
+
+            tracktion_engine::Renderer::Parameters params (edit);
+            params.destFile = benchmarkFile;
+            params.audioFormat = edit.engine.getAudioFileFormatManager().getWavFormat();
+            params.time = { 0.0, juce::jmax (renderLengthSeconds, edit.getLength()) };
+            params.tracksToDo = tracktion_engine::toBitSet (tracktion_engine::getAllTracks (edit));
+            params.usePlugins = true;
+            params.useMasterPlugins = true;
+            params.realTimeRender = false;
+
+            task = std::make_unique<tracktion_engine::Renderer::RenderTask> ("Graph benchmark", params, nullptr, nullptr);
+        }
+
+        const auto start = juce::Time::getMillisecondCounterHiRes();
+
+        while (task->runJob() == juce::ThreadPoolJob::jobNeedsRunningAgain)
+            if (threadShouldExit())
+                break;
+
+        const auto elapsed = (juce::Time::getMillisecondCounterHiRes() - start) * 0.001;
+
+        const juce::MessageManagerLock mml (this);
+        task.reset();
+
+        return elapsed;
+    }
+};
+
+//==============================================================================
+/*
+    Manual thread count/strategy selection plus the calibration button. The
+    owner applies the settings through onSettingsChanged.
+*/
+class GraphSettingsComponent : public juce::Component
+{
+public:
+    GraphSettingsComponent (tracktion_engine::Edit& e, GraphEngineBehaviour& b)
+        : edit (e), behaviour (b)
+    {
+        addAndMakeVisible (threadsList);
+        addAndMakeVisible (threadsLabel);
+        threadsLabel.setText ("Audio threads:", juce::dontSendNotification);
+        threadsLabel.attachToComponent (&threadsList, true);
+
+        // Item IDs are the thread count plus one, so "Default" can stand for 0
+        threadsList.addItem ("Default", 1);
+
+        for (int i = 1; i <= juce::SystemStats::getNumCpus(); ++i)
+            threadsList.addItem (juce::String (i), i + 1);
+
+        addAndMakeVisible (strategyList);
+        addAndMakeVisible (strategyLabel);
+        strategyLabel.setText ("Pool strategy:", juce::dontSendNotification);
+        strategyLabel.attachToComponent (&strategyList, true);
+
+        for (auto s : GraphSettings::getStrategies())
+            strategyList.addItem (GraphSettings::getStrategyName (s), (int) s + 1);
+
+        addAndMakeVisible (calibrateButton);
+        calibrateButton.onClick = [this] { calibrate(); };
+
+        addAndMakeVisible (report);
+        report.setMultiLine (true);
+        report.setReadOnly (true);
+        report.setText ("Machine: " + GraphSettings::getMachineDescription()
+                        + "\nRun the calibration to measure each setting against the current edit.\n");
+
+        refresh();
+
+        threadsList.onChange = strategyList.onChange = [this] { settingsChangedFromUI(); };
+
+        setSize (400, 300);
+    }
+
+    std::function<void (const GraphSettings&)> onSettingsChanged;
+
+    /** Called before a calibration starts, so the owner can stop its own transport. */
+    std::function<void()> onBenchmarkStarting;
+
+    void resized() override
+    {
+        auto r = getLocalBounds().reduced (10);
+        threadsList.setBounds (r.removeFromTop (24).withTrimmedLeft (110));
+        r.removeFromTop (6);
+        strategyList.setBounds (r.removeFromTop (24).withTrimmedLeft (110));
+        r.removeFromTop (6);
+        calibrateButton.setBounds (r.removeFromTop (24));
+        r.removeFromTop (6);
+        report.setBounds (r);
+    }
+
+private:
+    tracktion_engine::Edit& edit;
+    GraphEngineBehaviour& behaviour;
+
+    juce::ComboBox threadsList, strategyList;
+    juce::Label threadsLabel, strategyLabel;
+    juce::TextButton calibrateButton { "Calibrate" };
+    juce::TextEditor report;
+    std::unique_ptr<GraphBenchmark> benchmark;
+
+    void refresh()
+    {
+        const auto s = behaviour.getSettings();
+        threadsList.setSelectedId (s.numThreads + 1, juce::dontSendNotification);
+        strategyList.setSelectedId ((int) s.strategy + 1, juce::dontSendNotification);
+        strategyList.setEnabled (behaviour.getNumberOfCPUsToUseForAudio() > 1);
+    }
+
+    void settingsChangedFromUI()
+    {
+        GraphSettings s;
+        s.numThreads = threadsList.getSelectedId() - 1;
+        s.strategy = (GraphSettings::Strategy) (strategyList.getSelectedId() - 1);
+
+        s.saveForThisMachine();
+        applySettings (s);
+    }
+
+    void applySettings (const GraphSettings& s)
+    {
+        behaviour.setSettings (s);
+
+        if (onSettingsChanged)
+            onSettingsChanged (s);
+
+        refresh();
+    }
+
+    void calibrate()
+    {
+        if (onBenchmarkStarting)
+            onBenchmarkStarting();
+
+        benchmark = std::make_unique<GraphBenchmark> (edit, behaviour, [this] (const GraphBenchmark& b)
+        {
+            if (auto fastest = b.getFastest())
+            {
+                const auto text = b.getReport() + "\nFastest: " + fastest->settings.getDescription() + "\n";
+                report.setText (text);
+
+                fastest->settings.saveForThisMachine (text);
+                applySettings (fastest->settings);
+            }
+        });
+
+        benchmark->launchThread();
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GraphSettingsComponent)
+};
@@ -8,6 +8,7 @@
 
 #include <JuceHeader.h>
 #include "MainComponent.h"
+#include "RealtimeSanitizerHooks.h"
 
 //==============================================================================
 class MidiProjectApplication  : public juce::JUCEApplication
@@ -24,6 +25,7 @@ public:
     void initialise (const juce::String& commandLine) override
     {
         // This method is where you should put your application's initialisation code..
+        RealtimeSanitizer::initialise();
 
         mainWindow.reset (new MainWindow (getApplicationName()));
     }
@@ -33,6 +35,12 @@ public:
         // Add your application's shutdown code here..
 
         mainWindow = nullptr; // (deletes our window)
+        
+        if (auto numViolations = RealtimeSanitizer::getNumViolations())
+        {
+            juce::Logger::writeToLog ("Real-time sanitizer: " + juce::String (numViolations) + " violation(s) on the audio thread");
+            setApplicationReturnValue (1);
+        }
     }
 
     //==============================================================================
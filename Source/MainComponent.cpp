@@ -15,8 +15,17 @@ MainComponent::MainComponent()
     
     //========================================================================
     //audioMixer.addInputSource(&transportSource, true);
-    audioMixer.addInputSource(&engineAudioSource, true);
-    audioMixer.addInputSource(&metronome, true);
+    engineProfiledSource = std::make_unique<ProfiledAudioSource>(callbackProfiler, AudioCallbackProfiler::engineGraph, engineAudioSource);
+    metronomeProfiledSource = std::make_unique<ProfiledAudioSource>(callbackProfiler, AudioCallbackProfiler::metronome, metronome);
+    audioMixer.addInputSource(engineProfiledSource.get(), false);
+    audioMixer.addInputSource(metronomeProfiledSource.get(), false);
+    
+    addAndMakeVisible(cpuMeter);
+    cpuMeter.onShowTopTracks = [this]
+    {
+        auto list = std::make_unique<TrackLoadListComponent>(engineAudioSource.getEdit());
+        juce::CallOutBox::launchAsynchronously(std::move(list), cpuMeter.getScreenBounds(), nullptr);
+    };
     
     //========================================================================
     
@@ -65,6 +74,9 @@ MainComponent::MainComponent()
     
     deleteButton.setLookAndFeel(&otherLookAndFeel);
     
+    engineSettingsButton.onClick = [this] {engineSettingsButtonClicked();};
+    analyserButton.onClick = [this] {analyserButtonClicked();};
+    
     //========================================================================
     addAndMakeVisible(openButton);
     
@@ -79,6 +91,10 @@ MainComponent::MainComponent()
     
     addAndMakeVisible(deleteButton);
     
+    addAndMakeVisible(engineSettingsButton);
+    
+    addAndMakeVisible(analyserButton);
+    
     thumbnail.addChangeListener(this);
     //=======================================================================
     addAndMakeVisible(synthLabel);
@@ -122,6 +138,15 @@ MainComponent::MainComponent()
     midiInputList.addItemList(midiInputNames, 1);
     midiInputList.onChange = [this] {setMidiInput (midiInputList.getSelectedItemIndex());};
     
+    addAndMakeVisible(midiActivityLabel);
+    midiActivityLabel.setText("No MIDI activity", juce::dontSendNotification);
+    midiActivityLabel.setFont(juce::Font(12.0f));
+    midiActivityTimer.setCallback([this] {updateMidiActivity();});
+    midiActivityTimer.startTimerHz(15);
+    
+    addAndMakeVisible(lowLatencyButton);
+    lowLatencyButton.onClick = [this] {setLowLatencyMonitoring(lowLatencyButton.getToggleState());};
+    
     
     
     for(auto input: midiInputs)
@@ -178,12 +203,17 @@ MainComponent::MainComponent()
     addAndMakeVisible(tempoSlider);
     addAndMakeVisible(stepEditor.get());
     */
-    tempoSlider.setValue(engineAudioSource.getEdit().tempoSequence.getTempos()[0]->getBpm(), juce::dontSendNotification);
+    const auto initialBpm = engineAudioSource.getEdit().tempoSequence.getTempos()[0]->getBpm();
+    tempoSlider.setValue(initialBpm, juce::dontSendNotification);
+    engineAudioSource.getRealtimeTempo().setTargetBpm(initialBpm, false);
+    metronome.setTempoSource(&engineAudioSource.getRealtimeTempo());
     
     stepWindow.initalise();
+    stepWindow.onPlay = [this] {playButtonClicked();};
+    stepWindow.onStop = [this] {stopButtonClicked();};
     stepWindow.setTempoChangedCallback([this] (float floatValue)
     {
-        engineAudioSource.getEdit().tempoSequence.getTempos()[0]->setBpm(floatValue);
+        // The step window has already published the tempo, just keep the sliders in step
         tempoSlider.setValue(floatValue, juce::dontSendNotification);
     });
     //showStepSequencer();
@@ -211,8 +241,13 @@ MainComponent::MainComponent()
 
 MainComponent::~MainComponent()
 {
+    // The analyser window shows a member, so it can't outlive us
+    delete analyserWindow.getComponent();
+    
     // This shuts down the audio device and clears the audio source.
     shutdownAudio();
+    audioMixer.removeAllInputs();
+    deviceManager.removeMidiInputDeviceCallback(juce::MidiInput::getAvailableDevices()[lastInputIndex].identifier, this);
     auto& edit = engineAudioSource.getEdit();
     tracktion_engine::EditFileOperations (edit).save (true, true, false);
     engineAudioSource.getEngine().getTemporaryFileManager().getTempDirectory().deleteRecursively();
@@ -353,6 +388,7 @@ void MainComponent::createTracksAndAssignInputs()
     //synthAudioSource = new SynthAudioSource(virtualMidi->keyboardState);
     auto & engine = engineAudioSource.getEngine();
     engine.getPluginManager().createBuiltInType<SynthAudioSource>();
+    engine.getPluginManager().createBuiltInType<StepPlayerPlugin>();
     synthAudioSource = dynamic_cast<SynthAudioSource *>(edit.getPluginCache().createNewPlugin("SynthAudioSourcePlugin", {}).getObject());
     
     synthAudioSource->setKeyState(&virtualMidi->keyboardState);
@@ -360,10 +396,12 @@ void MainComponent::createTracksAndAssignInputs()
     tracktion_engine::getAudioTracks(edit)[1]->pluginList.insertPlugin(synthPluginPtr, 0, nullptr);
     
     engineAudioSource.setSynthSource(synthAudioSource);
+    liveSynth.store(synthAudioSource, std::memory_order_release);
     keyboardComponent = std::make_unique<juce::MidiKeyboardComponent> (virtualMidi->keyboardState, juce::MidiKeyboardComponent::horizontalKeyboard);
     virtualMidi->keyboardState.addListener(this);
     addAndMakeVisible(*keyboardComponent);
-    audioMixer.addInputSource(synthAudioSource, true);
+    synthProfiledSource = std::make_unique<ProfiledAudioSource>(callbackProfiler, AudioCallbackProfiler::synth, *synthAudioSource);
+    audioMixer.addInputSource(synthProfiledSource.get(), false);
     edit.restartPlayback();
 }
 
@@ -416,7 +454,7 @@ void MainComponent::setMidiInput(int index)
 {
     
     auto list = juce::MidiInput::getAvailableDevices();
-    deviceManager.removeMidiInputDeviceCallback(list[lastInputIndex].identifier, synthAudioSource->getMidiCollector());
+    deviceManager.removeMidiInputDeviceCallback(list[lastInputIndex].identifier, this);
     
     auto newInput = list[index];
     
@@ -424,13 +462,22 @@ void MainComponent::setMidiInput(int index)
     {
         deviceManager.setMidiInputDeviceEnabled(newInput.identifier, true);
     }
-    deviceManager.addMidiInputDeviceCallback(newInput.identifier, synthAudioSource->getMidiCollector());
+    deviceManager.addMidiInputDeviceCallback(newInput.identifier, this);
     midiInputList.setSelectedId(index + 1, juce::dontSendNotification);
     
     lastInputIndex = index;
     
 }
 
+// The synth hears live notes straight from its own queues, so the virtual input's
+// monitoring is switched off to stop them sounding twice. Recording through it carries on.
+void MainComponent::setLowLatencyMonitoring(bool shouldBeEnabled)
+{
+    synthAudioSource->setLowLatencyMonitoring(shouldBeEnabled);
+    virtualMidi->setEndToEndEnabled(! shouldBeEnabled);
+    lowLatencyButton.setToggleState(shouldBeEnabled, juce::dontSendNotification);
+}
+
 void MainComponent::setSynth(int index){
     synthAudioSource->setSynthPreset(index);
     lastSynthIndex = index;
@@ -444,51 +491,59 @@ void MainComponent::timerCallback()
 }
 
 
+// Device notes also arrive here, replayed through the keyboard state on the audio
+// thread, but they've already been counted in handleIncomingMidiMessage.
 void MainComponent::handleNoteOn(juce::MidiKeyboardState *, int midiChannel, int midiNoteNumber, float velocity)
 {
-    if(!midiInputSource)
+    auto message = juce::MidiMessage::noteOn(midiChannel, midiNoteNumber, velocity);
+    message.setTimeStamp(juce::Time::getMillisecondCounterHiRes() * 0.001);
+    
+    if(juce::MessageManager::existsAndIsCurrentThread())
     {
-        auto message = juce::MidiMessage::noteOn(midiChannel, midiNoteNumber, velocity);
-        message.setTimeStamp(juce::Time::getMillisecondCounterHiRes() * 0.001);
-        postMessageToList(message, "On-Screen Keyboard");
-        //keyboardState.processNextMidiEvent(message);
-        //keyboardState.noteOn(midiChannel, midiNoteNumber, velocity);
-        virtualMidi->handleIncomingMidiMessage(message);
-        
+        midiActivity.record(message);
+        synthAudioSource->injectLiveMessage(SynthAudioSource::LiveSource::keyboard, message);
     }
+    
+    virtualMidi->handleIncomingMidiMessage(message);
 }
 
 
 void MainComponent::handleNoteOff(juce::MidiKeyboardState *, int midiChannel, int midiNoteNumber, float)
 {
-    if(!midiInputSource)
+    auto message = juce::MidiMessage::noteOff(midiChannel, midiNoteNumber);
+    message.setTimeStamp(juce::Time::getMillisecondCounterHiRes() * 0.001);
+    
+    if(juce::MessageManager::existsAndIsCurrentThread())
     {
-        auto message = juce::MidiMessage::noteOff(midiChannel, midiNoteNumber);
-        message.setTimeStamp(juce::Time::getMillisecondCounterHiRes() * 0.001);
-        postMessageToList(message, "On-Screen Keyboard");
-        //keyboardState.processNextMidiEvent(message);
-        virtualMidi->handleIncomingMidiMessage(message);
+        midiActivity.record(message);
+        synthAudioSource->injectLiveMessage(SynthAudioSource::LiveSource::keyboard, message);
     }
+    
+    virtualMidi->handleIncomingMidiMessage(message);
 }
 
 
-
-
-void MainComponent::postMessageToList(const juce::MidiMessage &message, const juce::String &source)
+// Called on the MIDI device thread, so nothing in here may allocate, lock or post messages.
+void MainComponent::handleIncomingMidiMessage (juce::MidiInput*, const juce::MidiMessage& message)
 {
-    (new IncomingMessageCallback(this, message, source))->post();
+    midiActivity.record(message);
     
+    if(auto synth = liveSynth.load(std::memory_order_acquire))
+    {
+        synth->injectLiveMessage(SynthAudioSource::LiveSource::device, message);
+        synth->getLiveMidiFifo().push(message);
+    }
 }
 
-
-void MainComponent::handleIncomingMidiMessage (juce::MidiInput* source, const juce::MidiMessage& message)
+void MainComponent::updateMidiActivity()
 {
-    const juce::ScopedValueSetter<bool> scopedInputFlag(midiInputSource, true);
-    
-    DBG("GETTING MESSAGE");
-    keyboardState.processNextMidiEvent(message);
-    postMessageToList(message, source->getName());
+    const auto numEvents = midiActivity.numEvents.load(std::memory_order_acquire);
     
+    if(numEvents != lastMidiActivityCount)
+    {
+        lastMidiActivityCount = numEvents;
+        midiActivityLabel.setText(midiActivity.getDescription(), juce::dontSendNotification);
+    }
 }
 
 //============================================================================
@@ -517,7 +572,7 @@ void MainComponent::processMidiClip(tracktion_engine::MidiClip & midiClip)
     for(auto i = 0 ; i < midiClip.getSequence().getSysexEvents().size(); i++)
     {
         auto& midiMessage = midiClip.getSequence().getSysexEvents()[0]->getMessage();
-        postMessageToList(midiMessage, "On-Screen Keyboard");
+        midiActivity.record(midiMessage);
         
     }
 }
@@ -534,6 +589,7 @@ void MainComponent::playButtonClicked()
         transportSource.start();
         playState = TransportState::Playing;
         metronome.setTransportState(Metronome::TransportState::Playing);
+        stepWindow.setPlaying(true);
         DBG("Playing transport...:");
 
     }
@@ -556,6 +612,7 @@ void MainComponent::stopButtonClicked()
         transportSource.stop();
         playState = TransportState::Stopped;
         metronome.setTransportState(Metronome::TransportState::Stopped);
+        stepWindow.setPlaying(false);
         DBG("Stopping trasport...");
     }
 }
@@ -574,7 +631,14 @@ void MainComponent::openButtonClicked()
         {
             
             auto& edit = engineAudioSource.getEdit();
-            auto clip = EngineHelpers::loadAudioFileAsClip(edit, file);
+            tracktion_engine::WaveAudioClip::Ptr clip;
+            
+            {
+                // Clears the track first, so the view only catches up once it's all done
+                ChangeBatch::ScopedTransaction transaction;
+                clip = EngineHelpers::loadAudioFileAsClip(edit, file);
+            }
+            
             auto & transport = clip->edit.getTransport();
             DBG("Loaded Audio file as Clip");
             transport.setLoopRange(clip->getEditTimeRange());
@@ -628,6 +692,7 @@ void MainComponent::newTrackButtonClicked()
 
 void MainComponent::deleteButtonClicked()
 {
+    ChangeBatch::ScopedTransaction transaction;
     auto selection = selectionManager.getSelectedObject(0);
     if(auto clip = dynamic_cast<tracktion_engine::Clip *>(selection))
     {
@@ -642,92 +707,37 @@ void MainComponent::deleteButtonClicked()
     }
 }
 
-//==================================STEP-SEQUENCER-FUNCTIONS=================================================
-tracktion_engine::StepClip::Ptr MainComponent::getClip()
+void MainComponent::engineSettingsButtonClicked()
 {
+    auto content = std::make_unique<GraphSettingsComponent>(engineAudioSource.getEdit(), engineAudioSource.getGraphBehaviour());
+    content->onSettingsChanged = [this] (const GraphSettings&) {engineAudioSource.applyGraphSettings();};
+    content->onBenchmarkStarting = [this] {stopButtonClicked();};
     
-    if(auto track = EngineHelpers::getOrInsertAudioTrackAt(engineAudioSource.getEdit(), 0))
-    {
-        if(auto clip = dynamic_cast<tracktion_engine::StepClip*>(track->getClips()[0]))
-        {
-            return *clip;
-            
-        }
-    }
-    return {};
-
-}
-
-
-tracktion_engine::StepClip::Ptr MainComponent::createStepClip()
-{
-    //EDIT: change which track you actually might want to use
-    auto & edit = engineAudioSource.getEdit();
-    if(auto track = EngineHelpers::getOrInsertAudioTrackAt(edit, 0))
-    {
-        const tracktion_engine::EditTimeRange editTimeRange(0,edit.tempoSequence.barsBeatsToTime ({ 1, 0.0 }));
-        track->insertNewClip(tracktion_engine::TrackItem::Type::step, "Step Clip", editTimeRange, nullptr);
-        if(auto stepClip = getClip())
-        {
-            return EngineHelpers::loopAroundClip(*stepClip);
-        }
-    }
-    return {};
+    juce::DialogWindow::LaunchOptions o;
+    o.dialogTitle = "Engine Settings";
+    o.dialogBackgroundColour = LookAndFeel::getDefaultLookAndFeel().findColour(ResizableWindow::backgroundColourId);
+    o.content.setOwned(content.release());
+    o.resizable = true;
+    o.launchAsync();
 }
 
-
-Array<File> MainComponent::createSampleFiles()
+void MainComponent::analyserButtonClicked()
 {
-    Array<File> files;
-    const auto destDir = engineAudioSource.getEdit().getTempDirectory(true);
-    
-    jassert(destDir != File());
-    
-    using namespace DemoBinaryData;
-    
-    for(int i =0; i < tracktion_engine::TracktionBinaryData::namedResourceListSize; ++i)
+    if (analyserWindow != nullptr)
     {
-        const auto f = destDir.getChildFile(originalFilenames[i]);
-        
-        int dataSizeInBytes = 0;
-        const char* data = getNamedResource(namedResourceList[i], dataSizeInBytes);
-        
-        jassert(data != nullptr);
-        f.replaceWithData(data, dataSizeInBytes);
-        files.add(f);
+        analyserWindow->toFront(true);
+        return;
     }
-    return files;
     
+    juce::DialogWindow::LaunchOptions o;
+    o.dialogTitle = "Master Analyser";
+    o.dialogBackgroundColour = LookAndFeel::getDefaultLookAndFeel().findColour(ResizableWindow::backgroundColourId);
+    o.content.setOwned(new MasterAnalyserComponent(masterAnalyser));
+    o.resizable = true;
+    analyserWindow = o.launchAsync();
 }
 
-void MainComponent::createSamplerPlugin(Array<File> defaultSampleFiles)
-{
-    if(auto stepClip = getClip())
-    {
-        if(auto sampler = dynamic_cast<tracktion_engine::SamplerPlugin*>(engineAudioSource.getEdit().getPluginCache().createNewPlugin(tracktion_engine::SamplerPlugin::xmlTypeName, {}).get()))
-        {
-            stepClip->getTrack()->pluginList.insertPlugin(*sampler, 0, nullptr);
-            int channelCount = 0;
-            
-            for(auto channel : stepClip->getChannels())
-            {
-                const auto error = sampler->addSound(defaultSampleFiles[channelCount++].getFullPathName(), channel->name.get(), 0.0, 0.0, 1.0f);
-                sampler->setSoundParams(sampler->getNumSounds() - 1, channel->noteNumber, channel->noteNumber, channel->noteNumber);
-                jassert(error.isEmpty());
-                
-                for(auto &pattern :stepClip->getPatterns())
-                    pattern.randomiseChannel(channel->getIndex());
-            }
-            
-        }
-        else
-        {
-            jassertfalse; //StepClip not created...
-        }
-    }
-}
-
-
+//==================================STEP-SEQUENCER-FUNCTIONS=================================================
 void MainComponent::showStepSequencer()
 {
     topWindow = new ResizableWindow("Step Sequencer",true);
@@ -751,20 +761,19 @@ void MainComponent::showStepSequencer()
 }
 //=========================================SLIDER-FUNCTIONS===================================================
 
+// While dragging only the real-time tempo follows the slider, the tempo map is
+// rebuilt once when the drag ends.
 void MainComponent::sliderValueChanged(Slider * slider)
 {
-    
-    if(! ModifierKeys::getCurrentModifiers().isAnyMouseButtonDown())
-    {
-        engineAudioSource.getEdit().tempoSequence.getTempos()[0]->setBpm(tempoSlider.getValue());
-        stepWindow.setTempo(tempoSlider.getValue());
-    }
+    const bool isDragging = ModifierKeys::getCurrentModifiers().isAnyMouseButtonDown();
+    engineAudioSource.setTempo(tempoSlider.getValue(), ! isDragging);
+    stepWindow.setTempo(tempoSlider.getValue());
 }
 
 void MainComponent::sliderDragEnded(Slider * slider)
 {
     
-    engineAudioSource.getEdit().tempoSequence.getTempos()[0]->setBpm(tempoSlider.getValue());
+    engineAudioSource.setTempo(tempoSlider.getValue(), true);
     stepWindow.setTempo(tempoSlider.getValue());
     
 }
@@ -784,6 +793,8 @@ void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRat
     transportSource.prepareToPlay (samplesPerBlockExpected, sampleRate);
     */
     
+    callbackProfiler.prepare(sampleRate);
+    masterAnalyser.prepare(sampleRate);
     audioMixer.prepareToPlay(samplesPerBlockExpected, sampleRate);
 }
 
@@ -810,7 +821,10 @@ void MainComponent::getNextAudioBlock (const juce::AudioSourceChannelInfo& buffe
     transportSource.getNextAudioBlock (bufferToFill);
     */
     
+    const RealtimeSanitizer::ScopedRealtimeSection realtimeSection;
+    const AudioCallbackProfiler::ScopedCallback scopedCallback(callbackProfiler, bufferToFill.numSamples);
     audioMixer.getNextAudioBlock(bufferToFill);
+    masterAnalyser.push(bufferToFill);
     
     
 }
@@ -862,6 +876,10 @@ void MainComponent::resized()
     
     managementControlFb.items.add(juce::FlexItem (newTrackButton).withMinWidth (40.0f).withMinHeight (25.0f).withMargin(juce::FlexItem::Margin(2.0f,2.0f,2.0f,30.0f)));
     
+    managementControlFb.items.add(juce::FlexItem(engineSettingsButton).withMinWidth(60.0f).withMinHeight(25.0f).withMargin(juce::FlexItem::Margin(2.0f)));
+    
+    managementControlFb.items.add(juce::FlexItem(analyserButton).withMinWidth(60.0f).withMinHeight(25.0f).withMargin(juce::FlexItem::Margin(2.0f)));
+    
     managementControlFb.items.add(juce::FlexItem(deleteButton).withMinWidth(40.0f).withMinHeight(25.0f).withMargin(juce::FlexItem::Margin(2.0f,30.0f,2.0f,2.0f)));
     
     
@@ -890,6 +908,9 @@ void MainComponent::resized()
     synthList.setBounds(200, 350, getWidth() - 210, 20);
     midiInputList.setBounds (200, 380, getWidth() - 210, 20);
     keyboardComponent->setBounds (10,  410, getWidth() - 20, 100);
+    cpuMeter.setBounds(10, 520, getWidth() - 20, 20);
+    midiActivityLabel.setBounds(10, 545, getWidth() - 20, 20);
+    lowLatencyButton.setBounds(10, 570, 200, 20);
     
     if (editComponent != nullptr){
         editComponent->setBounds (20,  100, getWidth() - 20, 200);
@@ -6,6 +6,10 @@
 #include "../includes/common/Components.h"
 #include "StepEditor.h"
 #include "Metronome.h"
+#include "AudioCallbackProfiler.h"
+#include "RealtimeSanitizer.h"
+#include "MidiEventFifo.h"
+#include "MasterAnalyser.h"
 //==============================================================================
 /*
     This component lives inside our window, and this is where you should put all
@@ -23,7 +27,7 @@ class StepEditorWindow : public juce::Component, public juce::Slider::Listener
 {
 public:
     StepEditorWindow(EngineAudioSource& source)
-    : engineAudioSource(source), sampleFiles(createSampleFiles())
+    : engineAudioSource(source)
     {
         
         addAndMakeVisible(stepPlayPauseButton);
@@ -49,6 +53,26 @@ public:
         tempoLabel.setText("Tempo", juce::dontSendNotification);
         tempoLabel.attachToComponent(&tempoSlider,true);
         
+        // Groove controls only change the step player's precomputed table, never the pattern
+        addGrooveSlider(swingSlider, swingLabel, "Swing", 50.0, 75.0, " %");
+        addGrooveSlider(humaniseSlider, humaniseLabel, "Feel", 0.0, 25.0, " %");
+        addGrooveSlider(velocityHumaniseSlider, velocityHumaniseLabel, "Vel", 0.0, 100.0, " %");
+        
+        addAndMakeVisible(grooveButton);
+        grooveButton.onClick = [this] {grooveButtonClicked();};
+        
+        addAndMakeVisible(seedButton);
+        seedButton.onClick = [this] {newGeneratorSeed();};
+        
+        addAndMakeVisible(patternBox);
+        patternBox.onChange = [this] {patternSelected();};
+        
+        // Chains patterns as "A*4 B*2-1 A", see StepSong; left empty the edited pattern just loops
+        addAndMakeVisible(songInput);
+        songInput.setTextToShowWhenEmpty("Song", juce::Colours::grey);
+        songInput.onReturnKey = [this] {songChanged();};
+        songInput.onFocusLost = [this] {songChanged();};
+        
         
         
         
@@ -65,27 +89,211 @@ public:
         
     }
     
+    // Needs the main edit, so this is called once MainComponent has created it
     void initalise()
     {
-        
         createStepClip();
-        createSamplerPlugin(sampleFiles);
+        createStepPlayerPlugin();
+        loadDefaultSamples();
         
         stepEditor = std::make_unique<StepEditor>(*getClip());
         
         
         addAndMakeVisible(stepEditor.get());
-        viewPort.setViewedComponent(stepEditor.get(), false);
-        addAndMakeVisible(&viewPort);
         setSize(400,600);
-        configWidth = stepEditor->getWidth() - stepEditor->getPatternWidth();
-        stepInitWidth = stepEditor->getPatternWidth();
         
-        tempoSlider.setValue(engineAudioSource.getStepEdit().tempoSequence.getTempos()[0]->getBpm(), juce::dontSendNotification);
+        tempoSlider.setValue(engineAudioSource.getEdit().tempoSequence.getTempos()[0]->getBpm(), juce::dontSendNotification);
 
+        if(auto player = getPlayer())
+        {
+            const auto& groove = player->getGroove();
+            swingSlider.setValue(groove.swing, juce::dontSendNotification);
+            humaniseSlider.setValue(groove.timingHumanise * 100.0, juce::dontSendNotification);
+            velocityHumaniseSlider.setValue(groove.velocityHumanise * 100.0, juce::dontSendNotification);
+            updateGrooveButtonText();
+            updateSeedButtonText();
+            songInput.setText(player->getSong().toString(), juce::dontSendNotification);
+        }
+        
+        updatePatternBox();
+    }
+    
+    void grooveChanged()
+    {
+        if(auto player = getPlayer())
+        {
+            auto groove = player->getGroove();
+            groove.swing = (float) swingSlider.getValue();
+            groove.timingHumanise = (float) humaniseSlider.getValue() / 100.0f;
+            groove.velocityHumanise = (float) velocityHumaniseSlider.getValue() / 100.0f;
+            player->setGroove(groove);
+        }
+    }
+    
+    // Offers every MIDI and audio clip in the edit to learn a groove template from
+    void grooveButtonClicked()
+    {
+        auto player = getPlayer();
+        
+        if(player == nullptr)
+            return;
+        
+        juce::Array<tracktion_engine::Clip*> sources;
+        juce::PopupMenu menu;
+        menu.addItem(1, "No Template", true, player->getGroove().groove.isEmpty());
+        
+        for(auto track : tracktion_engine::getAudioTracks(engineAudioSource.getEdit()))
+        {
+            for(auto clip : track->getClips())
+            {
+                if(dynamic_cast<tracktion_engine::MidiClip*>(clip) != nullptr
+                   || dynamic_cast<tracktion_engine::WaveAudioClip*>(clip) != nullptr)
+                {
+                    sources.add(clip);
+                    menu.addItem(sources.size() + 1, track->getName() + ": " + clip->getName());
+                }
+            }
+        }
+        
+        menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(&grooveButton),
+                           [this, sources] (int result)
+                           {
+                               if(result > 0)
+                                   setGrooveTemplateFrom(result == 1 ? nullptr : sources[result - 2]);
+                           });
+    }
+    
+    void setGrooveTemplateFrom(tracktion_engine::Clip* source)
+    {
+        auto stepClip = getClip();
+        auto player = getPlayer();
+        
+        if(stepClip == nullptr || player == nullptr)
+            return;
+        
+        const auto stepLength = stepClip->getPattern(0).getNoteLength();
+        grooveLearner.cancel();
+        
+        // Audio has to be decoded, so its template arrives later
+        if(auto audioClip = dynamic_cast<tracktion_engine::WaveAudioClip*>(source))
+        {
+            grooveButton.setButtonText("Groove...");
+            grooveLearner.learnFromAudioClip(*audioClip, stepLength, [this] (const GrooveTemplate& t) {setGrooveTemplate(t);});
+            return;
+        }
+        
+        if(auto midiClip = dynamic_cast<tracktion_engine::MidiClip*>(source))
+            setGrooveTemplate(GrooveTemplate::fromMidiClip(*midiClip, stepLength));
+        else
+            setGrooveTemplate({});
+    }
+    
+    void setGrooveTemplate(const GrooveTemplate& newTemplate)
+    {
+        if(auto player = getPlayer())
+        {
+            auto groove = player->getGroove();
+            groove.groove = newTemplate;
+            player->setGroove(groove);
+        }
+        
+        updateGrooveButtonText();
+    }
+    
+    // Probability rolls all come from the seed, so the same seed always plays back the same
+    void newGeneratorSeed()
+    {
+        if(auto player = getPlayer())
+        {
+            player->setGeneratorSeed((juce::uint32) juce::Random::getSystemRandom().nextInt(99999) + 1);
+            updateSeedButtonText();
+        }
+    }
+    
+    void updateSeedButtonText()
+    {
+        if(auto player = getPlayer())
+            seedButton.setButtonText("Seed " + juce::String(player->getGeneratorSeed()));
+    }
+    
+    void patternSelected()
+    {
+        auto stepClip = getClip();
         
+        if(stepClip == nullptr || stepEditor == nullptr)
+            return;
+        
+        auto index = patternBox.getSelectedId() - 1;
+        
+        if(patternBox.getSelectedId() == newPatternID)
+        {
+            index = stepClip->insertNewPattern(stepClip->getPatterns().size());
+            stepClip->getPattern(index).setNumNotes(16 * barCount);
+        }
+        
+        stepEditor->setPatternIndex(index);
+        updatePatternBox();
     }
     
+    void updatePatternBox()
+    {
+        patternBox.clear(juce::dontSendNotification);
+        
+        if(auto stepClip = getClip())
+        {
+            const auto numPatterns = juce::jmin(StepSong::maxPatterns, stepClip->getPatterns().size());
+            
+            for(int i = 0; i < numPatterns; ++i)
+                patternBox.addItem(StepSong::getPatternName(i), i + 1);
+            
+            if(numPatterns < StepSong::maxPatterns)
+                patternBox.addItem("New", newPatternID);
+            
+            if(stepEditor != nullptr)
+                patternBox.setSelectedId(stepEditor->getPatternIndex() + 1, juce::dontSendNotification);
+        }
+    }
+    
+    void songChanged()
+    {
+        auto stepClip = getClip();
+        auto player = getPlayer();
+        
+        if(stepClip == nullptr || player == nullptr)
+            return;
+        
+        player->setSong(StepSong::fromString(songInput.getText()), *stepClip);
+        songInput.setText(player->getSong().toString(), juce::dontSendNotification);
+        updateClipLength();
+    }
+    
+    // A song sets the clip's length, otherwise it's the bar count
+    void updateClipLength()
+    {
+        if(auto stepClip = getClip())
+        {
+            const auto player = getPlayer();
+            const auto songLength = player != nullptr ? player->getSong().getLengthInBeats(*stepClip) : 0.0;
+            auto& tempoMap = engineAudioSource.getTempoMap();
+            
+            const auto timeDuration = songLength > 0.0 ? tempoMap.beatsToTime(songLength)
+                                                       : tempoMap.barsBeatsToTime({barCount, 0});
+            stepClip->setLength(timeDuration, true);
+            
+            auto& transport = stepClip->edit.getTransport();
+            if(transport.isPlaying() && transport.looping)
+                transport.setLoopRange(stepClip->getEditTimeRange());
+        }
+    }
+    
+    void updateGrooveButtonText()
+    {
+        if(auto player = getPlayer())
+            grooveButton.setButtonText(player->getGroove().groove.isEmpty() ? "Groove" : "Groove *");
+    }
+    
+    // Auditioning shares the main transport, so starting and stopping go through the
+    // owner's play/stop path (onPlay/onStop) to keep its transport state and metronome in step
     void playPlauseButtonClicked()
     {
         if(auto stepClip = getClip())
@@ -93,66 +301,46 @@ public:
             auto& transport = stepClip->edit.getTransport();
             if(transport.isPlaying())
             {
-                transport.stop(false,false);
-                stepPlayPauseButton.setButtonText(L"▶");
+                if(onStop)
+                    onStop();
             }
             else
             {
-                transport.play(true);
-                //Switch Fonts later
-                stepPlayPauseButton.setButtonText(L"\u007C \u007C");
-                
-
-                
+                // Looped around the step clip
+                transport.setLoopRange(stepClip->getEditTimeRange());
+                transport.looping = true;
+                transport.position = stepClip->getPosition().getStart();
                 
+                if(onPlay)
+                    onPlay();
             }
         }
         
     }
     
+    // The step clip already lives in the main edit, so confirming just ends the
+    // audition loop and hands the transport back to the arrangement.
     void confirmButtonClicked()
     {
         if(auto stepClip = getClip())
         {
-            auto  sequence = stepClip->getPatternSequence();
-            if(auto track = EngineHelpers::getOrInsertAudioTrackAt(engineAudioSource.getEdit(), 2))
-            {
-                const tracktion_engine::EditTimeRange editTimeRange(0,(engineAudioSource.getEdit().tempoSequence.barsBeatsToTime ({ barCount, 0.0 })));
-                track->insertNewClip(tracktion_engine::TrackItem::Type::step, "Step Clip", editTimeRange, nullptr);
-                if(auto track = EngineHelpers::getOrInsertAudioTrackAt(engineAudioSource.getEdit(), 2))
-                {
-                    if(auto clip = dynamic_cast<tracktion_engine::StepClip*>(track->getClips()[0]))
-                    {
-                        //CREATE SAMPLER PLUGIN NEXT
-                        if(auto sampler = dynamic_cast<tracktion_engine::SamplerPlugin*>(engineAudioSource.getEdit().getPluginCache().createNewPlugin(tracktion_engine::SamplerPlugin::xmlTypeName, {}).get()))
-                        {
-                            clip->getTrack()->pluginList.insertPlugin(*sampler, 0, nullptr);
-                            DBG("INSERTED PLUGIN ");
-                            int channelCount = 0;
-                            
-                            for(auto channel : clip->getChannels())
-                            {
-                                const auto error = sampler->addSound(sampleFiles[channelCount++].getFullPathName(), channel->name.get(), 0.0, 0.0, 1.0f);
-                                sampler->setSoundParams(sampler->getNumSounds() - 1, channel->noteNumber, channel->noteNumber, channel->noteNumber);
-                                jassert(error.isEmpty());
-                                
-                                clip->insertPattern(stepClip->getPattern(channel->getIndex()),channel->getIndex());
-
-                                
-    
-                            }
-                            DBG("STEP CLIP CHANNEL COUNT : " << channelCount);
-                            
-                        }
-                    }
-                }
-                                
-            }
+            if(onStop)
+                onStop();
             
+            stepClip->edit.getTransport().looping = false;
         }
 
     }
     
+    /** Called by the owner whenever its transport starts or stops. */
+    void setPlaying(bool isPlaying)
+    {
+        //Switch Fonts later
+        stepPlayPauseButton.setButtonText(isPlaying ? L"\u007C \u007C" : L"▶");
+    }
+    
+    std::function<void()> onPlay, onStop;
+    
     void stepCountChanged()
     {
         barCount = stepBarInput.getText().getIntValue();
@@ -160,37 +348,15 @@ public:
         {
             if(auto stepClip = getClip())
             {
-                auto timeDuration = engineAudioSource.getEdit().tempoSequence.barsBeatsToTime({barCount,0});
-                
                 auto numNotes = 16 * barCount;
                 
                 for(auto pattern : stepClip->getPatterns())
                 {
                     pattern.setNumNotes(numNotes);
                 }
-                stepClip->setLength(timeDuration,true);
-                EngineHelpers::loopAroundClip(*stepClip);
-                stepPlayPauseButton.setButtonText(L"\u007C \u007C");
-                if(barCount != 1)
-                {
-
-                    stepResize = true;
-                    auto diffSpace = 400 - (stepInitWidth + configWidth);
-                    auto newStepWidth  = (stepInitWidth * barCount) + configWidth; //Change this so it varies per bars
-                    auto windowWidth = ((stepInitWidth * 2) + configWidth) + diffSpace;
-                    stepEditor->setBounds(10, 70, newStepWidth, 300);
-                    setSize(windowWidth,600);//Prolly dont need to call this multiple times
-                    resized();
+                updateClipLength();
 
-                    
-                }
-                else
-                {
-                    setSize(400,600);
-                    stepResize = false;
-                    stepEditor->setBounds(10, 70, getWidth() - 20, 300);
-                    
-                }
+                // The editor scrolls over the steps itself, so its size doesn't depend on the bar count
                 stepEditor->updatePaths();
             }
         }
@@ -199,11 +365,8 @@ public:
     void setTempo(float tempo)
     {
         
-        if(! ModifierKeys::getCurrentModifiers().isAnyMouseButtonDown())
-        {
-            engineAudioSource.getStepEdit().tempoSequence.getTempos()[0]->setBpm(tempo);
-            tempoSlider.setValue(tempo, juce::dontSendNotification);
-        }
+        // The tempo itself is shared with the main edit, only the slider needs updating
+        tempoSlider.setValue(tempo, juce::dontSendNotification);
     }
     
     void setTempoChangedCallback(TempoChangedCallback cb)
@@ -212,17 +375,14 @@ public:
     }
     void sliderValueChanged (Slider *slider) override
     {
-        
-        if(! ModifierKeys::getCurrentModifiers().isAnyMouseButtonDown())
-        {
-            engineAudioSource.getStepEdit().tempoSequence.getTempos()[0]->setBpm(tempoSlider.getValue());
-            onTempoChanged(tempoSlider.getValue());
-        }
+        const bool isDragging = ModifierKeys::getCurrentModifiers().isAnyMouseButtonDown();
+        engineAudioSource.setTempo(tempoSlider.getValue(), ! isDragging);
+        onTempoChanged(tempoSlider.getValue());
     }
     void sliderDragEnded (Slider*) override
     {
         
-        engineAudioSource.getStepEdit().tempoSequence.getTempos()[0]->setBpm(tempoSlider.getValue());
+        engineAudioSource.setTempo(tempoSlider.getValue(), true);
         onTempoChanged(tempoSlider.getValue());
         
     }
@@ -249,15 +409,17 @@ public:
         stepAudioControlFb.performLayout(getLocalBounds().removeFromTop(60));
         
         stepBarInput.setBounds(getWidth() - 30, 30, 20, 25);
-        viewPort.setBounds(10, 70, getWidth()- 10, 300);
-        //viewPort.setBoundsRelative(0.00f, 0.1f, 1.0f, 1.0f);
         //stepPlayPauseButton.setBounds(10, 20, getWidth()-20, 25);
-        if(stepResize == false)
-        {
-            DBG("STEP RESIZE FALSE");
+        if(stepEditor != nullptr)
             stepEditor->setBounds(10, 70, getWidth() - 20, 300);
-        }
         tempoSlider.setBounds(50, 400, getWidth() - 50, 20);
+        swingSlider.setBounds(50, 430, getWidth() - 50, 20);
+        humaniseSlider.setBounds(50, 460, getWidth() - 50, 20);
+        velocityHumaniseSlider.setBounds(50, 490, getWidth() - 50, 20);
+        grooveButton.setBounds(50, 520, 100, 25);
+        seedButton.setBounds(160, 520, 100, 25);
+        patternBox.setBounds(50, 555, 60, 25);
+        songInput.setBounds(120, 555, getWidth() - 130, 25);
     }
     
     
@@ -283,19 +445,24 @@ private:
     juce::Slider tempoSlider;
     juce::Label tempoLabel;
     
+    juce::Slider swingSlider, humaniseSlider, velocityHumaniseSlider;
+    juce::Label swingLabel, humaniseLabel, velocityHumaniseLabel;
+    juce::TextButton grooveButton {"Groove"};
+    juce::TextButton seedButton {"Seed"};
+    juce::ComboBox patternBox;
+    juce::TextEditor songInput;
+    
+    static constexpr int newPatternID = 1000;
+    
     std::unique_ptr<StepEditor> stepEditor;
     
     ButtonLookAndFeel otherLookAndFeel;
     
     EngineAudioSource& engineAudioSource;
     
-    Array<File> sampleFiles;
+    SharedResourcePointer<SamplePool> samplePool;
     
-    Viewport viewPort;
-    
-    bool stepResize = false;
-    int stepInitWidth;
-    int configWidth;
+    GrooveLearner grooveLearner;
     
     int barCount = 1;
     
@@ -304,68 +471,52 @@ private:
     
     tracktion_engine::StepClip::Ptr createStepClip()
     {
-        //EDIT: change which track you actually might want to use
-        auto & edit = engineAudioSource.getStepEdit();
-        if(auto track = EngineHelpers::getOrInsertAudioTrackAt(edit, 0))
+        if(auto track = engineAudioSource.ensureStepTrack())
         {
-            const tracktion_engine::EditTimeRange editTimeRange(0,edit.tempoSequence.barsBeatsToTime ({ 1, 0.0 }));
+            const tracktion_engine::EditTimeRange editTimeRange(0,engineAudioSource.getTempoMap().barsBeatsToTime ({ 1, 0.0 }));
             track->insertNewClip(tracktion_engine::TrackItem::Type::step, "Step Clip", editTimeRange, nullptr);
-            if(auto stepClip = getClip())
-            {
-                stepPlayPauseButton.setButtonText(L"\u007C \u007C");
-                return EngineHelpers::loopAroundClip(*stepClip);
-            }
+            return getClip();
         }
         return {};
     }
     
-    Array<File> createSampleFiles()
-    {
-        Array<File> files;
-        const auto destDir = engineAudioSource.getStepEdit().getTempDirectory(true);
-        
-        jassert(destDir != File());
-        
-        using namespace DemoBinaryData;
-        
-        for(int i =0; i < tracktion_engine::TracktionBinaryData::namedResourceListSize; ++i)
-        {
-            const auto f = destDir.getChildFile(originalFilenames[i]);
-            
-            int dataSizeInBytes = 0;
-            const char* data = getNamedResource(namedResourceList[i], dataSizeInBytes);
-            
-            jassert(data != nullptr);
-            f.replaceWithData(data, dataSizeInBytes);
-            files.add(f);
-        }
-        return files;
-    }
-    
-    void createSamplerPlugin(Array<File> defaultSampleFiles)
+    // Every channel borrows its sound from the shared pool, decoded straight from the
+    // embedded data, so nothing is written to disk and each sound is only held once
+    void loadDefaultSamples()
     {
         if(auto stepClip = getClip())
         {
-            if(auto sampler = dynamic_cast<tracktion_engine::SamplerPlugin*>(engineAudioSource.getStepEdit().getPluginCache().createNewPlugin(tracktion_engine::SamplerPlugin::xmlTypeName, {}).get()))
+            if(auto player = stepClip->getTrack()->pluginList.findFirstPluginOfType<StepPlayerPlugin>())
             {
-                stepClip->getTrack()->pluginList.insertPlugin(*sampler, 0, nullptr);
+                using namespace DemoBinaryData;
                 int channelCount = 0;
                 
+                // Every pattern of every channel is rewritten, so hold the view's updates until the end
+                ChangeBatch::ScopedTransaction transaction;
+                
                 for(auto channel : stepClip->getChannels())
                 {
-                    const auto error = sampler->addSound(defaultSampleFiles[channelCount++].getFullPathName(), channel->name.get(), 0.0, 0.0, 1.0f);
-                    sampler->setSoundParams(sampler->getNumSounds() - 1, channel->noteNumber, channel->noteNumber, channel->noteNumber);
-                    jassert(error.isEmpty());
+                    if(channelCount >= namedResourceListSize)
+                        break;
+                    
+                    int dataSizeInBytes = 0;
+                    const char* data = getNamedResource(namedResourceList[channelCount], dataSizeInBytes);
+                    jassert(data != nullptr);
+                    
+                    const auto name = File::createFileWithoutCheckingPath(originalFilenames[channelCount++]).getFileNameWithoutExtension();
+                    player->setChannelSample(channel->getIndex(), samplePool->getSample(data, (size_t) dataSizeInBytes, name));
                     
                     for(auto &pattern :stepClip->getPatterns())
                     {
                         pattern.randomiseChannel(channel->getIndex());
                     }
-                        
                 }
                 DBG("STEP CLIP CHANNEL COUNT : " << channelCount);
                 DBG("PATTERN NOTE COUNT: " <<  stepClip->getPatternSequence()[0]->getPattern().getNumNotes());
-                
+            }
+            else
+            {
+                jassertfalse; //StepPlayerPlugin not created...
             }
         }
         else
@@ -375,9 +526,44 @@ private:
         
     }
     
+    // The player renders the step track itself, so it goes first in the chain
+    void createStepPlayerPlugin()
+    {
+        if(auto stepClip = getClip())
+        {
+            auto& pluginList = stepClip->getTrack()->pluginList;
+            
+            if(pluginList.findFirstPluginOfType<StepPlayerPlugin>() != nullptr)
+                return;
+            
+            if(auto player = engineAudioSource.getEdit().getPluginCache().createNewPlugin(StepPlayerPlugin::xmlTypeName, {}))
+                pluginList.insertPlugin(player, 0, nullptr);
+        }
+    }
+    
+    void addGrooveSlider(juce::Slider& slider, juce::Label& label, const juce::String& name, double min, double max, const juce::String& suffix)
+    {
+        addAndMakeVisible(slider);
+        slider.setRange(min, max, 0.1);
+        slider.setTextValueSuffix(suffix);
+        slider.onValueChange = [this] {grooveChanged();};
+        
+        addAndMakeVisible(label);
+        label.setText(name, juce::dontSendNotification);
+        label.attachToComponent(&slider, true);
+    }
+    
+    StepPlayerPlugin* getPlayer()
+    {
+        if(auto stepClip = getClip())
+            return stepClip->getTrack()->pluginList.findFirstPluginOfType<StepPlayerPlugin>().get();
+        
+        return nullptr;
+    }
+    
     tracktion_engine::StepClip::Ptr getClip()
     {
-        if(auto track = EngineHelpers::getOrInsertAudioTrackAt(engineAudioSource.getStepEdit(), 0))
+        if(auto track = engineAudioSource.getStepTrack())
         {
             if(auto clip = dynamic_cast<tracktion_engine::StepClip*>(track->getClips()[0]))
             {
@@ -417,6 +603,8 @@ public:
     
     void setSynth(int index);
     
+    void setLowLatencyMonitoring(bool shouldBeEnabled);
+    
     //======================================================
     void changeListenerCallback(juce::ChangeBroadcaster* source) override;
         
@@ -434,6 +622,10 @@ public:
     
     
     void deleteButtonClicked();
+    
+    void engineSettingsButtonClicked();
+    
+    void analyserButtonClicked();
     //======================================================================
     
     void createTracksAndAssignInputs();
@@ -453,12 +645,12 @@ public:
     
     void handleNoteOff(juce::MidiKeyboardState*, int midiChannel, int midiNoteNumber, float /*velocity*/) override;
     
-    void postMessageToList (const juce::MidiMessage& message, const juce::String& source);
-    
     void handleIncomingMidiMessage (juce::MidiInput* source, const juce::MidiMessage& message) override;
     
     void processMidiClip(tracktion_engine::MidiClip & midiClip);
     
+    void updateMidiActivity();
+    
     void showStepSequencer();
     //========================================================================================================
     void sliderValueChanged(Slider * ) override;
@@ -469,11 +661,16 @@ private:
     // Your private member variables go here...
     juce::MidiKeyboardState keyboardState;
     SynthAudioSource::Ptr synthPluginPtr;
-    SynthAudioSource * synthAudioSource;
+    SynthAudioSource * synthAudioSource = nullptr;
     std::unique_ptr<juce::MidiKeyboardComponent> keyboardComponent;
     
+    std::atomic<SynthAudioSource*> liveSynth {nullptr};
+    MidiActivity midiActivity;
+    juce::Label midiActivityLabel;
+    te::LambdaTimer midiActivityTimer;
+    juce::uint32 lastMidiActivityCount = 0;
     
-    bool midiInputSource;
+    juce::ToggleButton lowLatencyButton {"Low-latency monitoring"};
     
     juce::ComboBox midiInputList;
     juce::Label midiInputLabel;
@@ -505,6 +702,8 @@ private:
     juce::TextButton newTrackButton{L"\u2795"};
     juce::TextButton openButton {"open"};
     juce::TextButton deleteButton {L"\u274C"};
+    juce::TextButton engineSettingsButton {"Engine"};
+    juce::TextButton analyserButton {"Analyser"};
     
     juce::Slider tempoSlider;
     juce::Label tempoLabel;
@@ -522,6 +721,13 @@ private:
     
     juce::MixerAudioSource audioMixer;
     
+    AudioCallbackProfiler callbackProfiler;
+    std::unique_ptr<ProfiledAudioSource> engineProfiledSource, metronomeProfiledSource, synthProfiledSource;
+    CpuMeterComponent cpuMeter {callbackProfiler};
+    
+    MasterAnalyser masterAnalyser;
+    juce::Component::SafePointer<juce::DialogWindow> analyserWindow;
+    
     
     enum TransportState
     {
@@ -549,13 +755,6 @@ private:
     
     //========================================================================
     
-    tracktion_engine::StepClip::Ptr createStepClip();
-    
-    Array<File> createSampleFiles();
-    
-    void createSamplerPlugin(Array<File> defaultSampleFiles);
-    
-    tracktion_engine::StepClip::Ptr getClip();
     
 
     
@@ -564,27 +763,6 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainComponent)
 };
 
-class IncomingMessageCallback : public juce::CallbackMessage
-{
-public:
-    IncomingMessageCallback(MainComponent * mcc, const MidiMessage& mm, const juce::String& s): owner(mcc), message(mm), source(s)
-    {
-        
-    }
-    
-    void messageCallback() override
-    {
-        if(owner != nullptr)
-        {
-            //owner->addMessageToList(message, source);
-        }
-    }
-    
-    
-    Component::SafePointer<MainComponent> owner;
-    juce::MidiMessage message;
-    juce::String source;
-};
 
 
 
@@ -0,0 +1,560 @@
+/*
+  ==============================================================================
+
+    MasterAnalyser.h
+    Created: 19 Oct 2026 11:02:18pm
+    Author:  Samuel Chadri
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../includes/common/FrameClock.h"
+
+//==============================================================================
+/*
+    Spectrum, loudness and true peak of the master output, worked out on a
+    background thread.
+
+    All the audio thread does is copy each block into a single-producer FIFO.
+    If the analyser falls behind, whatever doesn't fit is dropped and counted
+    rather than waited for, so no FFT size can make the callback late. The
+    worker drains the FIFO, runs the FFT at most once per drain and publishes
+    the latest results under a lock only it and the UI ever take.
+
+    Loudness follows ITU-R BS.1770: K-weighted mean square over 400ms
+    (momentary) and 3s (short term), and gated integrated loudness from a
+    histogram of the 400ms blocks, so it costs the same however long it runs.
+    True peak is measured on a 4x oversampled copy.
+*/
+class MasterAnalyser : private juce::Thread
+{
+public:
+    static constexpr int minFFTOrder = 9, maxFFTOrder = 14, defaultFFTOrder = 12;
+    static constexpr int fifoSize = 1 << 17;
+    static constexpr float silenceDecibels = -100.0f;
+
+    struct Results
+    {
+        std::vector<float> spectrumDecibels;    // One per bin up to Nyquist
+        double sampleRate = 44100.0;
+        float momentaryLUFS = silenceDecibels, shortTermLUFS = silenceDecibels, integratedLUFS = silenceDecibels;
+        float truePeakDecibels = silenceDecibels, maxTruePeakDecibels = silenceDecibels;
+        juce::int64 numDropped = 0;
+        juce::uint32 sequence = 0;
+    };
+
+    MasterAnalyser()
+        : juce::Thread ("Master Analyser"), fifo (fifoSize)
+    {
+        for (auto& c : fifoData)
+            c.resize ((size_t) fifoSize);
+
+        startThread (3);
+    }
+
+    ~MasterAnalyser() override
+    {
+        stopThread (2000);
+    }
+
+    //==============================================================================
+    /** Called before the audio thread starts pushing. */
+    void prepare (double newSampleRate)
+    {
+        sampleRate.store (newSampleRate, std::memory_order_relaxed);
+        resetRequested.store (true, std::memory_order_release);
+    }
+
+    /** Audio thread. Mono outputs are analysed as both channels. */
+    void push (const juce::AudioSourceChannelInfo& info) noexcept
+    {
+        auto& buffer = *info.buffer;
+
+        if (buffer.getNumChannels() == 0 || info.numSamples <= 0)
+            return;
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (info.numSamples, start1, size1, start2, size2);
+
+        auto copy = [&] (int destStart, int sourceOffset, int num)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+                juce::FloatVectorOperations::copy (fifoData[(size_t) ch].data() + destStart,
+                                                   buffer.getReadPointer (juce::jmin (ch, buffer.getNumChannels() - 1),
+                                                                          info.startSample + sourceOffset),
+                                                   num);
+        };
+
+        if (size1 > 0)  copy (start1, 0, size1);
+        if (size2 > 0)  copy (start2, size1, size2);
+
+        fifo.finishedWrite (size1 + size2);
+
+        if (size1 + size2 < info.numSamples)
+            numDropped.fetch_add (info.numSamples - (size1 + size2), std::memory_order_relaxed);
+    }
+
+    //==============================================================================
+    /** Any thread. Takes effect from the next FFT. */
+    void setFFTOrder (int order)        { fftOrder.store (juce::jlimit (minFFTOrder, maxFFTOrder, order), std::memory_order_relaxed); }
+    int getFFTOrder() const noexcept    { return fftOrder.load (std::memory_order_relaxed); }
+
+    /** Any thread. Starts the integrated loudness and maximum true peak again. */
+    void resetIntegrated()              { resetRequested.store (true, std::memory_order_release); }
+
+    Results getLatestResults() const
+    {
+        const juce::SpinLock::ScopedLockType sl (resultsLock);
+        return latest;
+    }
+
+private:
+    static constexpr int numChannels = 2;
+    static constexpr int maxChunk = 1024;
+    static constexpr int oversamplingFactorLog2 = 2;
+    static constexpr int subBlocksPerMomentary = 4, subBlocksPerShortTerm = 30;
+    static constexpr float absoluteGateLUFS = -70.0f, relativeGateLU = -10.0f;
+    static constexpr int histogramBinsPerLU = 10, histogramSize = 100 * histogramBinsPerLU;
+
+    // Written by the audio thread, read here
+    juce::AbstractFifo fifo;
+    std::array<std::vector<float>, numChannels> fifoData;
+    std::atomic<double> sampleRate { 44100.0 };
+    std::atomic<int> fftOrder { defaultFFTOrder };
+    std::atomic<bool> resetRequested { true };
+    std::atomic<juce::int64> numDropped { 0 };
+
+    // Worker thread only
+    double currentSampleRate = 0.0;
+    int currentFFTOrder = 0;
+    std::unique_ptr<juce::dsp::FFT> fft;
+    std::vector<float> window, fftData, history, spectrum;
+    size_t historyPosition = 0;
+    int samplesSinceFFT = 0;
+
+    std::array<juce::dsp::IIR::Filter<float>, numChannels> shelfFilters, highPassFilters;
+    std::array<float, maxChunk> weighted;
+    double subBlockSum = 0.0;
+    int subBlockLength = 4410, subBlockFill = 0;
+    std::array<double, subBlocksPerShortTerm> subBlocks {};
+    int numSubBlocks = 0;
+    std::array<juce::int64, histogramSize> histogramCounts {};
+    std::array<double, histogramSize> histogramEnergy {};
+
+    std::unique_ptr<juce::dsp::Oversampling<float>> oversampling;
+    float truePeak = 0.0f, maxTruePeak = 0.0f;
+
+    juce::SpinLock resultsLock;
+    Results latest;
+
+    //==============================================================================
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            if (resetRequested.exchange (false, std::memory_order_acquire)
+                 || currentSampleRate != sampleRate.load (std::memory_order_relaxed))
+                reset();
+
+            if (currentFFTOrder != fftOrder.load (std::memory_order_relaxed))
+                prepareFFT();
+
+            const auto numReady = fifo.getNumReady();
+
+            if (numReady == 0)
+            {
+                wait (10);
+                continue;
+            }
+
+            int start1, size1, start2, size2;
+            fifo.prepareToRead (numReady, start1, size1, start2, size2);
+
+            for (auto [start, size] : { std::make_pair (start1, size1), std::make_pair (start2, size2) })
+                for (int offset = 0; offset < size; offset += maxChunk)
+                    process (start + offset, juce::jmin (maxChunk, size - offset));
+
+            fifo.finishedRead (size1 + size2);
+
+            // However much arrived, the spectrum is only worked out once per drain
+            if (samplesSinceFFT >= (1 << currentFFTOrder) / 4)
+                performFFT();
+
+            publish();
+        }
+    }
+
+    void reset()
+    {
+        currentSampleRate = sampleRate.load (std::memory_order_relaxed);
+        subBlockLength = juce::jmax (1, juce::roundToInt (currentSampleRate / 10.0));
+        subBlockSum = 0.0;
+        subBlockFill = numSubBlocks = 0;
+        histogramCounts.fill (0);
+        histogramEnergy.fill (0.0);
+        truePeak = maxTruePeak = 0.0f;
+
+        prepareKWeighting();
+
+        oversampling = std::make_unique<juce::dsp::Oversampling<float>> ((size_t) numChannels, (size_t) oversamplingFactorLog2,
+                                                                         juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR);
+        oversampling->initProcessing ((size_t) maxChunk);
+    }
+
+    void prepareFFT()
+    {
+        currentFFTOrder = fftOrder.load (std::memory_order_relaxed);
+        const auto size = (size_t) 1 << currentFFTOrder;
+
+        fft = std::make_unique<juce::dsp::FFT> (currentFFTOrder);
+        window.resize (size);
+        juce::dsp::WindowingFunction<float>::fillWindowingTables (window.data(), size, juce::dsp::WindowingFunction<float>::hann, false);
+
+        fftData.assign (size * 2, 0.0f);
+        spectrum.assign (size / 2, silenceDecibels);
+        history.assign ((size_t) 1 << maxFFTOrder, 0.0f);
+        historyPosition = 0;
+        samplesSinceFFT = 0;
+    }
+
+    // The BS.1770 pre-filter and RLB high-pass, worked out for the current rate
+    void prepareKWeighting()
+    {
+        const auto fs = currentSampleRate;
+
+        {
+            const double f0 = 1681.974450955533, gain = 3.999843853973347, q = 0.7071752369554196;
+            const auto k = std::tan (juce::MathConstants<double>::pi * f0 / fs);
+            const auto vh = std::pow (10.0, gain / 20.0);
+            const auto vb = std::pow (vh, 0.4996667741545416);
+            const auto a0 = 1.0 + k / q + k * k;
+
+            for (auto& f : shelfFilters)
+                f.coefficients = new juce::dsp::IIR::Coefficients<float> ((float) ((vh + vb * k / q + k * k) / a0),
+                                                                          (float) (2.0 * (k * k - vh) / a0),
+                                                                          (float) ((vh - vb * k / q + k * k) / a0),
+                                                                          1.0f,
+                                                                          (float) (2.0 * (k * k - 1.0) / a0),
+                                                                          (float) ((1.0 - k / q + k * k) / a0));
+        }
+
+        {
+            const double f0 = 38.13547087602444, q = 0.5003270373238773;
+            const auto k = std::tan (juce::MathConstants<double>::pi * f0 / fs);
+            const auto a0 = 1.0 + k / q + k * k;
+
+            for (auto& f : highPassFilters)
+                f.coefficients = new juce::dsp::IIR::Coefficients<float> (1.0f, -2.0f, 1.0f, 1.0f,
+                                                                          (float) (2.0 * (k * k - 1.0) / a0),
+                                                                          (float) ((1.0 - k / q + k * k) / a0));
+        }
+
+        for (auto& f : shelfFilters)        f.reset();
+        for (auto& f : highPassFilters)     f.reset();
+    }
+
+    //==============================================================================
+    void process (int start, int num)
+    {
+        // Mono for the spectrum, before anything else touches the data
+        const auto historySize = history.size();
+
+        for (int i = 0; i < num; ++i)
+        {
+            history[historyPosition] = 0.5f * (fifoData[0][(size_t) (start + i)] + fifoData[1][(size_t) (start + i)]);
+            historyPosition = (historyPosition + 1) % historySize;
+        }
+
+        samplesSinceFFT += num;
+
+        // True peak
+        float* channels[numChannels] = { fifoData[0].data(), fifoData[1].data() };
+        const juce::dsp::AudioBlock<const float> block (channels, (size_t) numChannels, (size_t) start, (size_t) num);
+        auto oversampled = oversampling->processSamplesUp (block);
+
+        for (size_t ch = 0; ch < oversampled.getNumChannels(); ++ch)
+        {
+            const auto range = juce::FloatVectorOperations::findMinAndMax (oversampled.getChannelPointer (ch), (int) oversampled.getNumSamples());
+            truePeak = juce::jmax (truePeak, -range.getStart(), range.getEnd());
+        }
+
+        maxTruePeak = juce::jmax (maxTruePeak, truePeak);
+
+        // Loudness, a 100ms sub-block at a time
+        for (int offset = 0; offset < num;)
+        {
+            const auto n = juce::jmin (num - offset, subBlockLength - subBlockFill);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                auto* source = fifoData[(size_t) ch].data() + start + offset;
+
+                for (int i = 0; i < n; ++i)
+                    weighted[(size_t) i] = highPassFilters[(size_t) ch].processSample (shelfFilters[(size_t) ch].processSample (source[i]));
+
+                subBlockSum += sumOfSquares (weighted.data(), n);
+            }
+
+            offset += n;
+            subBlockFill += n;
+
+            if (subBlockFill == subBlockLength)
+                finishSubBlock();
+        }
+    }
+
+    static double sumOfSquares (const float* data, int num) noexcept
+    {
+        double sum = 0.0;
+
+        for (int i = 0; i < num; ++i)
+            sum += (double) data[i] * data[i];
+
+        return sum;
+    }
+
+    void finishSubBlock()
+    {
+        std::move (subBlocks.begin() + 1, subBlocks.end(), subBlocks.begin());
+        subBlocks.back() = subBlockSum / subBlockLength;
+        numSubBlocks = juce::jmin (numSubBlocks + 1, subBlocksPerShortTerm);
+        subBlockSum = 0.0;
+        subBlockFill = 0;
+
+        // Every 100ms completes a 400ms gating block, overlapping the last by 75%
+        if (numSubBlocks >= subBlocksPerMomentary)
+        {
+            const auto energy = getMeanEnergy (subBlocksPerMomentary);
+            const auto loudness = energyToLUFS (energy);
+
+            if (loudness > absoluteGateLUFS)
+            {
+                const auto bin = juce::jlimit (0, histogramSize - 1, (int) ((loudness - absoluteGateLUFS) * histogramBinsPerLU));
+                ++histogramCounts[(size_t) bin];
+                histogramEnergy[(size_t) bin] += energy;
+            }
+        }
+    }
+
+    double getMeanEnergy (int numToAverage) const noexcept
+    {
+        const auto num = juce::jmin (numToAverage, numSubBlocks);
+
+        if (num == 0)
+            return 0.0;
+
+        double sum = 0.0;
+
+        for (int i = 0; i < num; ++i)
+            sum += subBlocks[subBlocks.size() - 1 - (size_t) i];
+
+        return sum / num;
+    }
+
+    static float energyToLUFS (double energy) noexcept
+    {
+        return energy > 0.0 ? juce::jmax (silenceDecibels, (float) (-0.691 + 10.0 * std::log10 (energy))) : silenceDecibels;
+    }
+
+    float getIntegratedLUFS() const noexcept
+    {
+        auto gatedMean = [this] (int firstBin)
+        {
+            double energy = 0.0;
+            juce::int64 count = 0;
+
+            for (int i = juce::jmax (0, firstBin); i < histogramSize; ++i)
+            {
+                energy += histogramEnergy[(size_t) i];
+                count += histogramCounts[(size_t) i];
+            }
+
+            return count > 0 ? energy / (double) count : 0.0;
+        };
+
+        const auto ungated = energyToLUFS (gatedMean (0));
+
+        if (ungated <= silenceDecibels)
+            return silenceDecibels;
+
+        const auto relativeGate = ungated + relativeGateLU;
+        return energyToLUFS (gatedMean ((int) std::ceil ((relativeGate - absoluteGateLUFS) * histogramBinsPerLU)));
+    }
+
+    //==============================================================================
+    void performFFT()
+    {
+        samplesSinceFFT = 0;
+
+        const auto size = (size_t) fft->getSize();
+        const auto historySize = history.size();
+        auto readPosition = (historyPosition + historySize - size) % historySize;
+
+        // The last fftSize samples, oldest first
+        const auto firstPart = juce::jmin (size, historySize - readPosition);
+        std::copy_n (history.data() + readPosition, firstPart, fftData.data());
+        std::copy_n (history.data(), size - firstPart, fftData.data() + firstPart);
+        std::fill (fftData.begin() + (std::ptrdiff_t) size, fftData.end(), 0.0f);
+
+        juce::FloatVectorOperations::multiply (fftData.data(), window.data(), (int) size);
+        fft->performFrequencyOnlyForwardTransform (fftData.data());
+
+        // A full scale sine through a Hann window peaks at size / 4
+        const auto scale = 4.0f / (float) size;
+
+        for (size_t i = 0; i < spectrum.size(); ++i)
+            spectrum[i] = juce::Decibels::gainToDecibels (fftData[i] * scale, silenceDecibels);
+    }
+
+    void publish()
+    {
+        Results r;
+        r.spectrumDecibels = spectrum;
+        r.sampleRate = currentSampleRate;
+        r.momentaryLUFS = energyToLUFS (getMeanEnergy (subBlocksPerMomentary));
+        r.shortTermLUFS = energyToLUFS (getMeanEnergy (subBlocksPerShortTerm));
+        r.integratedLUFS = getIntegratedLUFS();
+        r.truePeakDecibels = juce::Decibels::gainToDecibels (truePeak, silenceDecibels);
+        r.maxTruePeakDecibels = juce::Decibels::gainToDecibels (maxTruePeak, silenceDecibels);
+        r.numDropped = numDropped.load (std::memory_order_relaxed);
+        truePeak = 0.0f;
+
+        const juce::SpinLock::ScopedLockType sl (resultsLock);
+        r.sequence = latest.sequence + 1;
+        latest = std::move (r);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (MasterAnalyser)
+};
+
+//==============================================================================
+/*
+    Draws the analyser's latest results: the spectrum on a log frequency scale
+    with the loudness and true peak readings over it.
+*/
+class MasterAnalyserComponent : public juce::Component,
+                                private FrameClock::Client
+{
+public:
+    MasterAnalyserComponent (MasterAnalyser& a)
+        : analyser (a)
+    {
+        for (int order = MasterAnalyser::minFFTOrder; order <= MasterAnalyser::maxFFTOrder; ++order)
+            fftSizeBox.addItem (juce::String (1 << order), order);
+
+        fftSizeBox.setSelectedId (analyser.getFFTOrder(), juce::dontSendNotification);
+        fftSizeBox.onChange = [this] { analyser.setFFTOrder (fftSizeBox.getSelectedId()); };
+        resetButton.onClick = [this] { analyser.resetIntegrated(); };
+
+        addAndMakeVisible (fftSizeBox);
+        addAndMakeVisible (resetButton);
+
+        setSize (500, 300);
+        frameClock->addClient (this);
+    }
+
+    ~MasterAnalyserComponent() override
+    {
+        frameClock->removeClient (this);
+    }
+
+    void paint (juce::Graphics& g) override
+    {
+        g.fillAll (juce::Colours::black);
+
+        auto r = getLocalBounds().reduced (4);
+        auto textArea = r.removeFromTop (20);
+        textArea.removeFromRight (fftSizeBox.getWidth() + resetButton.getWidth() + 8);
+
+        auto format = [] (float db) { return db <= MasterAnalyser::silenceDecibels ? juce::String ("-inf") : juce::String (db, 1); };
+
+        g.setColour (results.maxTruePeakDecibels > -1.0f ? juce::Colours::orange : juce::Colours::white);
+        g.setFont (14.0f);
+        g.drawText ("M " + format (results.momentaryLUFS) + "   S " + format (results.shortTermLUFS)
+                      + "   I " + format (results.integratedLUFS) + " LUFS   TP " + format (shownTruePeak)
+                      + " (" + format (results.maxTruePeakDecibels) + ") dBTP",
+                    textArea, juce::Justification::centredLeft);
+
+        drawSpectrum (g, r.toFloat());
+    }
+
+    void resized() override
+    {
+        auto r = getLocalBounds().reduced (4).removeFromTop (20);
+        resetButton.setBounds (r.removeFromRight (50));
+        r.removeFromRight (4);
+        fftSizeBox.setBounds (r.removeFromRight (80));
+    }
+
+private:
+    MasterAnalyser& analyser;
+    MasterAnalyser::Results results;
+    float shownTruePeak = MasterAnalyser::silenceDecibels;
+
+    juce::ComboBox fftSizeBox;
+    juce::TextButton resetButton {"Reset"};
+    juce::SharedResourcePointer<FrameClock> frameClock;
+
+    static constexpr float minFrequency = 20.0f, minDecibels = -96.0f;
+
+    bool updateFrame (FrameClock::Frame&) override
+    {
+        auto newResults = analyser.getLatestResults();
+
+        if (newResults.sequence == results.sequence)
+            return false;
+
+        // The true peak reading is held, then falls about 20dB a second
+        shownTruePeak = juce::jmax (newResults.truePeakDecibels, shownTruePeak - 0.33f);
+        results = std::move (newResults);
+        repaint();
+        return true;
+    }
+
+    // One point per pixel, the loudest bin under it
+    void drawSpectrum (juce::Graphics& g, juce::Rectangle<float> area) const
+    {
+        const auto numBins = (int) results.spectrumDecibels.size();
+
+        if (numBins < 2 || area.getWidth() < 2.0f)
+            return;
+
+        const auto nyquist = (float) results.sampleRate * 0.5f;
+        const auto binWidth = nyquist / (float) numBins;
+        const auto logRange = std::log (nyquist / minFrequency);
+
+        auto xToBin = [&] (float x)
+        {
+            const auto frequency = minFrequency * std::exp (logRange * (x - area.getX()) / area.getWidth());
+            return juce::jlimit (0, numBins - 1, (int) (frequency / binWidth));
+        };
+
+        auto dbToY = [&] (float db)
+        {
+            return juce::jmap (juce::jlimit (minDecibels, 0.0f, db), minDecibels, 0.0f, area.getBottom(), area.getY());
+        };
+
+        juce::Path path;
+
+        for (float x = area.getX(); x < area.getRight(); x += 1.0f)
+        {
+            const auto first = xToBin (x);
+            const auto last = juce::jmax (first + 1, xToBin (x + 1.0f));
+            auto db = MasterAnalyser::silenceDecibels;
+
+            for (int bin = first; bin < last && bin < numBins; ++bin)
+                db = juce::jmax (db, results.spectrumDecibels[(size_t) bin]);
+
+            if (path.isEmpty())
+                path.startNewSubPath (x, dbToY (db));
+            else
+                path.lineTo (x, dbToY (db));
+        }
+
+        g.setColour (juce::Colours::skyblue);
+        g.strokePath (path, juce::PathStrokeType (1.5f));
+    }
+};
@@ -12,6 +12,7 @@
 
 #include <JuceHeader.h>
 #include "Data.h"
+#include "RealtimeTempo.h"
 
 
 struct MetronomeSound: public juce::SynthesiserSound
@@ -312,8 +313,10 @@ public:
         mSampleRate = sampleRate;
         DBG("SAMPLE RATE: " << sampleRate);
         samplesPerBeat = 60 / bpm * sampleRate;
+        tempoFollower.prepare(sampleRate, tempoSource != nullptr ? tempoSource->getTargetBpm() : bpm);
         synth.setCurrentPlaybackSampleRate(sampleRate);
         midiCollector.reset(sampleRate);
+        incomingMidi.ensureSize(2048);
         
         for (int i = 0; i < synth.getNumVoices(); i++)
         {
@@ -337,46 +340,30 @@ public:
         }
     }
     
-    void countSamples(int samplesPerBlock)
+    // Clicks on every beat, with the phase advanced per sample at the live tempo so
+    // they stay on the beat through a ramp, in step with the step player.
+    void addClicksToBuffer(int numSamples)
     {
-        totalSamples += samplesPerBlock;
-        //DBG("TOTAL SAMPLES: " << totalSamples);
-        //DBG("SAMPLES PER BLOCK: " <<  samplesPerBlock);
-        //DBG("SAMPLES PER BEAT: " << samplesPerBeat);
-        int beatNum = totalSamples / samplesPerBeat;
+        if(tempoSource != nullptr)
+            tempoFollower.update(*tempoSource);
         
-        if(beatNum != totalBeatNum)
+        for(int i = 0; i < numSamples; i++)
         {
-            totalBeatNum = beatNum;
-            DBG("BEAT NUMBER : " << totalBeatNum);
-            double time = juce::Time::getMillisecondCounterHiRes() * 0.001 - startTime;
-            DBG("TOTAL SAMPLES: " << totalSamples);
-            MidiMessage mOn = MidiMessage::noteOn(1, 60, 1.0f);
-            auto timestamp = (int) time * mSampleRate;
-            DBG("TIMESTAMP MON: " << timestamp);
-            mOn.setTimeStamp(timestamp);
-            metroNotes.push_back(mOn);
-            metroTimes.push_back(totalSamples);
-            //midiCollector.addMessageToQueue(mOn);
-
-            noteCounter++;
-            
-            MidiMessage mOff = MidiMessage::noteOff(1,60, 1.0f);
-            timestamp = (int) (time + (1/8))* (mSampleRate);
-            mOff.setTimeStamp(timestamp);
-            metroNotes.push_back(mOff);
-            auto noteOffTime = totalSamples + ((int) mSampleRate/10);
-            //midiCollector.addMessageToQueue(mOff);
-            metroTimes.push_back(noteOffTime);
-            noteCounter++;
-            DBG("NOTE OFF SAMPLES: "  << noteOffTime);
-            //midiCollector.addMessageToQueue(mOff);
+            if(beatPhase >= 1.0)
+            {
+                beatPhase -= 1.0;
+                incomingMidi.addEvent(MidiMessage::noteOn(1, 60, 1.0f), i);
+                samplesUntilNoteOff = (int) (mSampleRate / 10);
+                modBeatNum = ++totalBeatNum % 4;
+            }
+            else if(samplesUntilNoteOff > 0 && --samplesUntilNoteOff == 0)
+            {
+                incomingMidi.addEvent(MidiMessage::noteOff(1, 60, 1.0f), i);
+            }
             
+            beatPhase += tempoSource != nullptr ? tempoFollower.getNextBeatsPerSample()
+                                                : bpm / (60.0 * mSampleRate);
         }
-        
-        modBeatNum = beatNum % 4;
-        
-        
     }
     
     void setBpm(double newBpm)
@@ -384,39 +371,30 @@ public:
         bpm = newBpm;
     }
     
-    
-    void mReset()
+    /** When set, the clicks follow this tempo instead of the fixed bpm. */
+    void setTempoSource(const RealtimeTempo* newTempoSource)
     {
-        totalSamples = 0;
+        tempoSource = newTempoSource;
     }
     
-    void addMessageToBuffer( int sampleBlock)
+    
+    // Audio thread only, the message thread asks for it through resetRequested
+    void mReset()
     {
-        auto endOfBuffer = totalSamples + sampleBlock;
-        auto nextSample = metroTimes[currentNote];
-        
-        while(nextSample < endOfBuffer && currentNote < metroTimes.size())
-        {
-            //DIS A LIE. I ON KNOW WHO CAME UP WIT THIS BULLSHIT.
-            
-            auto position = int(nextSample % sampleBlock);
-            DBG("SAMPLE POSTION: " << position);
-            
-            incomingMidi.addEvent(metroNotes[currentNote], nextSample);
-            currentNote++;
-            
-            if(currentNote >= metroTimes.size())
-                break;
-            
-            nextSample = metroTimes[currentNote];
-            
-        }
+        beatPhase = 1.0;
+        totalBeatNum = -1;
+        samplesUntilNoteOff = 0;
     }
     
     void setTransportState(TransportState state)
     {
-        currState = state;
-        if(currState == TransportState::Stopped)
+        if(state == TransportState::Playing && currState.load() != TransportState::Playing)
+        {
+            resetRequested.store(true, std::memory_order_release);
+        }
+        
+        currState.store(state);
+        if(state == TransportState::Stopped)
         {
             synth.allNotesOff(1,false);
         }
@@ -432,13 +410,20 @@ public:
         bufferToFill.clearActiveBufferRegion();
         incomingMidi.clear();
         
-        if(currState == TransportState::Playing)
+        if(resetRequested.exchange(false, std::memory_order_acquire))
+            mReset();
+        
+        if(currState.load() == TransportState::Playing)
         {
-            countSamples(bufferToFill.numSamples);
-            if(!metroNotes.empty())
-                addMessageToBuffer(bufferToFill.numSamples);
+            addClicksToBuffer(bufferToFill.numSamples);
 
         }
+        else if(tempoSource != nullptr)
+        {
+            // Keeps ramping while stopped, so playback starts at the tempo the slider shows
+            tempoFollower.update(*tempoSource);
+            tempoFollower.advance(bufferToFill.numSamples);
+        }
 
         
 
@@ -574,19 +559,19 @@ private:
     double mSampleRate;
     double samplesPerBeat;
     double bpm {120} ;
-    double totalSamples;
     int totalBeatNum = -1;
     int modBeatNum;
     int nextSampleNum;
     
-    int currentNote {0};
-    std::vector<juce::int64> metroTimes;
-    std::vector<juce::MidiMessage> metroNotes;
-    int noteCounter {0};
+    double beatPhase {1.0};
+    int samplesUntilNoteOff {0};
+    const RealtimeTempo* tempoSource {nullptr};
+    RealtimeTempo::Follower tempoFollower;
+    std::atomic<bool> resetRequested {false};
     double startTime;
     
     
-    TransportState currState {TransportState::Stopped};
+    std::atomic<TransportState> currState {TransportState::Stopped};
     
     juce::Synthesiser synth;
     juce::MidiMessageCollector midiCollector;
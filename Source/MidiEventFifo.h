@@ -0,0 +1,184 @@
+/*
+  ==============================================================================
+
+    MidiEventFifo.h
+    Created: 19 Oct 2026 1:05:33pm
+    Author:  Samuel Chadri
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Coalesced, lock-free picture of recent MIDI traffic for display. Any thread
+    can record into it; the UI just polls it at whatever rate it likes, so a
+    dense controller stream costs the message thread nothing extra.
+*/
+struct MidiActivity
+{
+    void record (const juce::uint8* data, int size) noexcept
+    {
+        if (size <= 0)
+            return;
+
+        const auto status = data[0] & 0xf0;
+
+        if (size >= 3 && status == 0x90 && data[2] > 0)
+        {
+            setNoteBit (data[1], true);
+            lastNote.store (data[1], std::memory_order_relaxed);
+            lastVelocity.store (data[2], std::memory_order_relaxed);
+        }
+        else if (size >= 3 && (status == 0x80 || status == 0x90))
+        {
+            setNoteBit (data[1], false);
+        }
+        else if (size >= 3 && status == 0xb0)
+        {
+            controllers[data[1] & 0x7f].store (data[2], std::memory_order_relaxed);
+            lastController.store (data[1] & 0x7f, std::memory_order_relaxed);
+        }
+
+        numEvents.fetch_add (1, std::memory_order_release);
+    }
+
+    void record (const juce::MidiMessage& m) noexcept
+    {
+        record (m.getRawData(), m.getRawDataSize());
+    }
+
+    bool isNoteOn (int noteNumber) const noexcept
+    {
+        return (noteBits[(noteNumber & 0x7f) >> 5].load (std::memory_order_relaxed) & (1u << (noteNumber & 31))) != 0;
+    }
+
+    juce::String getDescription() const
+    {
+        juce::String s;
+
+        if (auto note = lastNote.load (std::memory_order_relaxed); note >= 0)
+            s << juce::MidiMessage::getMidiNoteName (note, true, true, 3)
+              << " vel " << lastVelocity.load (std::memory_order_relaxed) << "   ";
+
+        if (auto cc = lastController.load (std::memory_order_relaxed); cc >= 0)
+            s << "CC" << cc << " " << (int) controllers[cc].load (std::memory_order_relaxed) << "   ";
+
+        return s << numEvents.load (std::memory_order_acquire) << " events";
+    }
+
+    std::atomic<juce::uint32> numEvents { 0 };
+    std::atomic<int> lastNote { -1 }, lastVelocity { 0 }, lastController { -1 };
+    std::atomic<juce::uint8> controllers[128] = {};
+
+private:
+    void setNoteBit (int noteNumber, bool on) noexcept
+    {
+        auto& word = noteBits[(noteNumber & 0x7f) >> 5];
+        const auto bit = 1u << (noteNumber & 31);
+
+        if (on)
+            word.fetch_or (bit, std::memory_order_relaxed);
+        else
+            word.fetch_and (~bit, std::memory_order_relaxed);
+    }
+
+    std::atomic<juce::uint32> noteBits[4] = {};
+};
+
+//==============================================================================
+/*
+    Single-producer/single-consumer ring of timestamped short MIDI messages.
+    The MIDI thread pushes, the audio thread drains into a MidiBuffer with
+    sample offsets derived from the timestamps, so events keep their spacing
+    at a constant one-block latency (the same scheme MidiMessageCollector uses,
+    without the lock).
+*/
+class MidiEventFifo
+{
+public:
+    MidiEventFifo (int capacity = 1024)
+        : fifo (capacity), events ((size_t) capacity)
+    {
+    }
+
+    /** Call before the audio thread starts draining. */
+    void prepare (double newSampleRate, juce::MidiBuffer& bufferToDrainInto)
+    {
+        sampleRate = newSampleRate;
+        bufferToDrainInto.ensureSize ((size_t) fifo.getTotalSize() * 16);
+    }
+
+    /** Producer side. Returns false (and drops the event) if the consumer has fallen behind. */
+    bool push (const juce::MidiMessage& m) noexcept
+    {
+        const auto size = m.getRawDataSize();
+
+        if (size > 3)
+            return false; // Sysex goes the slow way
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+        if (size1 == 0)
+        {
+            numDropped.fetch_add (1, std::memory_order_relaxed);
+            return false;
+        }
+
+        auto& e = events[(size_t) start1];
+        e.timeStamp = m.getTimeStamp();
+        e.size = (juce::uint8) size;
+        std::memcpy (e.data, m.getRawData(), (size_t) size);
+
+        fifo.finishedWrite (1);
+        return true;
+    }
+
+    /** Consumer side, called once per audio block. */
+    void drainInto (juce::MidiBuffer& dest, int numSamples) noexcept
+    {
+        if (numSamples <= 0 || fifo.getNumReady() == 0)
+            return;
+
+        const auto now = juce::Time::getMillisecondCounterHiRes() * 0.001;
+
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (fifo.getNumReady(), start1, size1, start2, size2);
+
+        auto addEvents = [&] (int start, int num)
+        {
+            for (int i = start; i < start + num; ++i)
+            {
+                auto& e = events[(size_t) i];
+                const auto samplesAgo = juce::roundToInt ((now - e.timeStamp) * sampleRate);
+
+                dest.addEvent (e.data, e.size, juce::jlimit (0, numSamples - 1, numSamples - 1 - samplesAgo));
+            }
+        };
+
+        addEvents (start1, size1);
+        addEvents (start2, size2);
+        fifo.finishedRead (size1 + size2);
+    }
+
+    int getNumDropped() const noexcept      { return numDropped.load (std::memory_order_relaxed); }
+
+private:
+    struct Event
+    {
+        double timeStamp = 0.0;
+        juce::uint8 data[3] = {};
+        juce::uint8 size = 0;
+    };
+
+    juce::AbstractFifo fifo;
+    std::vector<Event> events;
+    double sampleRate = 44100.0;
+    std::atomic<int> numDropped { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (MidiEventFifo)
+};
@@ -0,0 +1,201 @@
+/*
+  ==============================================================================
+
+    RealtimeSanitizer.h
+    Created: 19 Oct 2026 11:02:17am
+    Author:  Samuel Chadri
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/*
+    Debug/CI aid that traps heap allocation and mutex locking on the audio
+    thread. Build with PROJECTX_RT_SANITIZER=1 to enable it, the hooks it relies
+    on live in RealtimeSanitizerHooks.h which is compiled into Main.cpp only.
+
+    Any section of code wrapped in a ScopedRealtimeSection is checked. The first
+    few violations are reported to stderr with a stack trace, after that only the
+    count goes up. Set PROJECTX_RT_SANITIZER_ABORT=1 (as a preprocessor define or
+    an environment variable) to abort on the first one instead.
+*/
+#ifndef PROJECTX_RT_SANITIZER
+ #define PROJECTX_RT_SANITIZER 0
+#endif
+
+#ifndef PROJECTX_RT_SANITIZER_ABORT
+ #define PROJECTX_RT_SANITIZER_ABORT 0
+#endif
+
+#if PROJECTX_RT_SANITIZER && ! (JUCE_MAC || JUCE_LINUX)
+ #error "The real-time sanitizer is only supported on macOS and Linux"
+#endif
+
+#if PROJECTX_RT_SANITIZER
+ #include <pthread.h>
+ #include <execinfo.h>
+ #include <unistd.h>
+#endif
+
+namespace RealtimeSanitizer
+{
+   #if PROJECTX_RT_SANITIZER
+    namespace detail
+    {
+        // Thread-locals can allocate on first use on some platforms, which would
+        // recurse straight back into the malloc hook, so the real-time threads
+        // are tracked in a small fixed table keyed by pthread_self() instead.
+        struct Slot
+        {
+            std::atomic<std::uintptr_t> thread { 0 };
+            int depth = 0, disabledDepth = 0;
+            bool reporting = false;
+        };
+
+        static constexpr int maxRealtimeThreads = 16;
+        static constexpr int maxReportedViolations = 32;
+
+        inline Slot slots[maxRealtimeThreads];
+        inline std::atomic<int> numActiveSections { 0 };
+        inline std::atomic<int> numViolations { 0 };
+        inline std::atomic<bool> abortOnViolation { PROJECTX_RT_SANITIZER_ABORT != 0 };
+
+        inline std::uintptr_t getThreadKey() noexcept
+        {
+            return (std::uintptr_t) pthread_self();
+        }
+
+        inline Slot* findSlot (std::uintptr_t key) noexcept
+        {
+            for (auto& s : slots)
+                if (s.thread.load (std::memory_order_acquire) == key)
+                    return &s;
+
+            return nullptr;
+        }
+
+        inline Slot* findOrClaimSlot (std::uintptr_t key) noexcept
+        {
+            if (auto s = findSlot (key))
+                return s;
+
+            for (auto& s : slots)
+            {
+                std::uintptr_t expected = 0;
+
+                if (s.thread.compare_exchange_strong (expected, key, std::memory_order_acq_rel))
+                    return &s;
+            }
+
+            return nullptr;
+        }
+
+        inline void writeString (const char* text) noexcept
+        {
+            auto len = std::strlen (text);
+            juce::ignoreUnused (::write (STDERR_FILENO, text, len));
+        }
+    }
+
+    //==============================================================================
+    /** Call once at startup, before any audio runs. */
+    inline void initialise() noexcept
+    {
+        if (auto env = std::getenv ("PROJECTX_RT_SANITIZER_ABORT"))
+            detail::abortOnViolation = (env[0] == '1');
+
+        // The first backtrace() can load the unwinder and allocate, so get that out of the way now
+        void* frames[4];
+        juce::ignoreUnused (backtrace (frames, 4));
+    }
+
+    inline int getNumViolations() noexcept
+    {
+        return detail::numViolations.load (std::memory_order_relaxed);
+    }
+
+    /** Called by the hooks, reports if the current thread is inside a real-time section. */
+    inline void notifyBlockingCall (const char* functionName) noexcept
+    {
+        if (detail::numActiveSections.load (std::memory_order_relaxed) == 0)
+            return;
+
+        auto slot = detail::findSlot (detail::getThreadKey());
+
+        if (slot == nullptr || slot->depth == 0 || slot->disabledDepth > 0 || slot->reporting)
+            return;
+
+        slot->reporting = true;
+
+        if (detail::numViolations.fetch_add (1, std::memory_order_relaxed) < detail::maxReportedViolations)
+        {
+            detail::writeString ("\n*** Real-time violation: ");
+            detail::writeString (functionName);
+            detail::writeString (" called on the audio thread\n");
+
+            void* frames[64];
+            auto numFrames = backtrace (frames, 64);
+            backtrace_symbols_fd (frames, numFrames, STDERR_FILENO);
+        }
+
+        if (detail::abortOnViolation.load (std::memory_order_relaxed))
+            std::abort();
+
+        slot->reporting = false;
+    }
+
+    //==============================================================================
+    /** Marks the current thread as real-time for the lifetime of this object. */
+    struct ScopedRealtimeSection
+    {
+        ScopedRealtimeSection() noexcept
+            : slot (detail::findOrClaimSlot (detail::getThreadKey()))
+        {
+            jassert (slot != nullptr); // More real-time threads than slots?
+
+            if (slot != nullptr && slot->depth++ == 0)
+                detail::numActiveSections.fetch_add (1, std::memory_order_relaxed);
+        }
+
+        ~ScopedRealtimeSection() noexcept
+        {
+            if (slot != nullptr && --slot->depth == 0)
+            {
+                detail::numActiveSections.fetch_sub (1, std::memory_order_relaxed);
+                slot->thread.store (0, std::memory_order_release);
+            }
+        }
+
+        detail::Slot* const slot;
+    };
+
+    /** Lets a known, deliberate non-real-time call through without reporting it. */
+    struct ScopedDisable
+    {
+        ScopedDisable() noexcept
+            : slot (detail::findSlot (detail::getThreadKey()))
+        {
+            if (slot != nullptr)
+                ++slot->disabledDepth;
+        }
+
+        ~ScopedDisable() noexcept
+        {
+            if (slot != nullptr)
+                --slot->disabledDepth;
+        }
+
+        detail::Slot* const slot;
+    };
+   #else
+    inline void initialise() noexcept {}
+    inline int getNumViolations() noexcept   { return 0; }
+    inline void notifyBlockingCall (const char*) noexcept {}
+
+    struct ScopedRealtimeSection    { ScopedRealtimeSection() noexcept {} };
+    struct ScopedDisable            { ScopedDisable() noexcept {} };
+   #endif
+}
@@ -0,0 +1,171 @@
+/*
+  ==============================================================================
+
+    RealtimeSanitizerHooks.h
+    Created: 19 Oct 2026 11:40:52am
+    Author:  Samuel Chadri
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "RealtimeSanitizer.h"
+
+/*
+    Replacement allocation and locking entry points used by the real-time
+    sanitizer. These define global symbols, so this must only ever be included
+    from one translation unit (Main.cpp).
+
+    Because JUCE and tracktion are compiled into the executable, defining the C
+    symbols here makes the linker bind all of their calls to these versions,
+    which then forward to the system implementation.
+*/
+#if PROJECTX_RT_SANITIZER
+
+#include <dlfcn.h>
+#include <new>
+
+#if JUCE_MAC
+ #include <malloc/malloc.h>
+#endif
+
+namespace RealtimeSanitizer
+{
+    namespace hooks
+    {
+       #if JUCE_LINUX
+        extern "C" void* __libc_malloc (size_t);
+        extern "C" void* __libc_calloc (size_t, size_t);
+        extern "C" void* __libc_realloc (void*, size_t);
+        extern "C" void  __libc_free (void*);
+
+        inline void* realMalloc (size_t n) noexcept               { return __libc_malloc (n); }
+        inline void* realCalloc (size_t c, size_t n) noexcept     { return __libc_calloc (c, n); }
+        inline void* realRealloc (void* p, size_t n) noexcept     { return __libc_realloc (p, n); }
+        inline void  realFree (void* p) noexcept                  { __libc_free (p); }
+       #else
+        // Going through the zone API avoids the malloc symbol altogether, so there's no recursion
+        inline void* realMalloc (size_t n) noexcept               { return malloc_zone_malloc (malloc_default_zone(), n); }
+        inline void* realCalloc (size_t c, size_t n) noexcept     { return malloc_zone_calloc (malloc_default_zone(), c, n); }
+
+        inline void* realRealloc (void* p, size_t n) noexcept
+        {
+            auto zone = p != nullptr ? malloc_zone_from_ptr (p) : nullptr;
+            return malloc_zone_realloc (zone != nullptr ? zone : malloc_default_zone(), p, n);
+        }
+
+        inline void realFree (void* p) noexcept
+        {
+            if (p != nullptr)
+                if (auto zone = malloc_zone_from_ptr (p))
+                    malloc_zone_free (zone, p);
+        }
+       #endif
+
+        using MutexFunction = int (*) (pthread_mutex_t*);
+
+        inline MutexFunction findNextMutexFunction (const char* name) noexcept
+        {
+            return reinterpret_cast<MutexFunction> (dlsym (RTLD_NEXT, name));
+        }
+
+        inline MutexFunction realMutexLock = findNextMutexFunction ("pthread_mutex_lock");
+    }
+}
+
+//==============================================================================
+extern "C"
+{
+    void* malloc (size_t n)
+    {
+        RealtimeSanitizer::notifyBlockingCall ("malloc");
+        return RealtimeSanitizer::hooks::realMalloc (n);
+    }
+
+    void* calloc (size_t count, size_t n)
+    {
+        RealtimeSanitizer::notifyBlockingCall ("calloc");
+        return RealtimeSanitizer::hooks::realCalloc (count, n);
+    }
+
+    void* realloc (void* p, size_t n)
+    {
+        RealtimeSanitizer::notifyBlockingCall ("realloc");
+        return RealtimeSanitizer::hooks::realRealloc (p, n);
+    }
+
+    void free (void* p)
+    {
+        if (p != nullptr)
+            RealtimeSanitizer::notifyBlockingCall ("free");
+
+        RealtimeSanitizer::hooks::realFree (p);
+    }
+
+    int pthread_mutex_lock (pthread_mutex_t* mutex)
+    {
+        using namespace RealtimeSanitizer::hooks;
+
+        RealtimeSanitizer::notifyBlockingCall ("pthread_mutex_lock");
+
+        if (realMutexLock == nullptr)
+            realMutexLock = findNextMutexFunction ("pthread_mutex_lock");
+
+        return realMutexLock (mutex);
+    }
+}
+
+//==============================================================================
+void* operator new (std::size_t n)
+{
+    RealtimeSanitizer::notifyBlockingCall ("operator new");
+
+    if (auto p = RealtimeSanitizer::hooks::realMalloc (n == 0 ? 1 : n))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t n)
+{
+    RealtimeSanitizer::notifyBlockingCall ("operator new[]");
+
+    if (auto p = RealtimeSanitizer::hooks::realMalloc (n == 0 ? 1 : n))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new (std::size_t n, const std::nothrow_t&) noexcept
+{
+    RealtimeSanitizer::notifyBlockingCall ("operator new");
+    return RealtimeSanitizer::hooks::realMalloc (n == 0 ? 1 : n);
+}
+
+void* operator new[] (std::size_t n, const std::nothrow_t&) noexcept
+{
+    RealtimeSanitizer::notifyBlockingCall ("operator new[]");
+    return RealtimeSanitizer::hooks::realMalloc (n == 0 ? 1 : n);
+}
+
+void operator delete (void* p) noexcept
+{
+    if (p != nullptr)
+        RealtimeSanitizer::notifyBlockingCall ("operator delete");
+
+    RealtimeSanitizer::hooks::realFree (p);
+}
+
+void operator delete[] (void* p) noexcept
+{
+    if (p != nullptr)
+        RealtimeSanitizer::notifyBlockingCall ("operator delete[]");
+
+    RealtimeSanitizer::hooks::realFree (p);
+}
+
+void operator delete (void* p, std::size_t) noexcept     { operator delete (p); }
+void operator delete[] (void* p, std::size_t) noexcept   { operator delete[] (p); }
+
+#endif
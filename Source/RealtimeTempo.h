@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    RealtimeTempo.h
+    Created: 19 Oct 2026 3:47:15pm
+    Author:  Samuel Chadri
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Live tempo, shared by everything that renders to a beat. The UI publishes a
+    target BPM with a single atomic store, so a slider drag can call it on every
+    mouse move, and the Edit's tempo map is only committed when the gesture ends.
+
+    Each renderer keeps a Follower, which ramps to the target linearly over 50ms
+    one sample at a time. Followers that see the same target in the same block
+    stay in step with each other without sharing any audio-thread state.
+
+    Tracktion's graph has no per-sample tempo input, so audio and MIDI clips keep
+    playing at the committed map's tempo until the drag ends. The metronome and
+    StepPlayerPlugin follow the live tempo. Get at it through a
+    SharedResourcePointer<RealtimeTempo>.
+*/
+class RealtimeTempo
+{
+public:
+    RealtimeTempo() = default;
+
+    /** Any thread. live marks a tempo the Edit's map hasn't been given yet, which
+        renderers that normally follow the map should follow instead.
+    */
+    void setTargetBpm (double newBpm, bool isLiveChange) noexcept
+    {
+        targetBpm.store (newBpm, std::memory_order_relaxed);
+        live.store (isLiveChange, std::memory_order_release);
+    }
+
+    double getTargetBpm() const noexcept     { return targetBpm.load (std::memory_order_relaxed); }
+    bool isLive() const noexcept             { return live.load (std::memory_order_acquire); }
+
+    //==============================================================================
+    /** One renderer's ramp towards the target. Audio thread only, apart from prepare(). */
+    class Follower
+    {
+    public:
+        void prepare (double newSampleRate, double startBpm) noexcept
+        {
+            sampleRate = newSampleRate;
+            current = target = startBpm;
+            step = 0.0;
+            rampSamplesLeft = 0;
+        }
+
+        /** At the top of each block. Starts a ramp if the target has moved. */
+        void update (const RealtimeTempo& tempo) noexcept
+        {
+            const auto newTarget = tempo.getTargetBpm();
+
+            if (newTarget == target)
+                return;
+
+            target = newTarget;
+            rampSamplesLeft = juce::jmax (1, juce::roundToInt (rampLengthSeconds * sampleRate));
+            step = (target - current) / rampSamplesLeft;
+        }
+
+        /** How far through a beat the next sample moves, stepping the ramp on by one. */
+        double getNextBeatsPerSample() noexcept
+        {
+            const auto beatsPerSample = current / (60.0 * sampleRate);
+            advance (1);
+            return beatsPerSample;
+        }
+
+        /** The beats the next numSamples cover, without moving on. */
+        double getBeatsOver (int numSamples) const noexcept
+        {
+            // Sample i plays at current + i * step until the ramp ends, then at the target
+            const auto k = (double) juce::jmin (numSamples, rampSamplesLeft);
+            const auto bpmSamples = k * current + step * k * (k - 1.0) * 0.5 + (numSamples - k) * target;
+            return bpmSamples / (60.0 * sampleRate);
+        }
+
+        /** The first of the next numSamples by which the beat has moved on by at least beats. */
+        int getSampleForBeats (double beats, int numSamples) const noexcept
+        {
+            int lo = 0, hi = numSamples;
+
+            while (lo < hi)
+            {
+                const auto mid = (lo + hi) / 2;
+
+                if (getBeatsOver (mid) < beats)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+
+            return lo;
+        }
+
+        void advance (int numSamples) noexcept
+        {
+            const auto k = juce::jmin (numSamples, rampSamplesLeft);
+            current += step * k;
+            rampSamplesLeft -= k;
+
+            if (rampSamplesLeft == 0)
+                current = target;
+        }
+
+        double getCurrentBpm() const noexcept    { return current; }
+
+    private:
+        double sampleRate = 44100.0, current = 120.0, target = 120.0, step = 0.0;
+        int rampSamplesLeft = 0;
+    };
+
+private:
+    static constexpr double rampLengthSeconds = 0.05;
+
+    std::atomic<double> targetBpm { 120.0 };
+    std::atomic<bool> live { false };
+
+    JUCE_DECLARE_NON_COPYABLE (RealtimeTempo)
+};
@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    SamplePool.h
+    Created: 19 Oct 2026 6:24:37pm
+    Author:  Samuel Chadri
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    Process-wide store of decoded samples, keyed by a hash of the encoded data,
+    so the same sound is only ever decoded and held in memory once however many
+    channels or players use it. Embedded sounds are decoded straight from
+    memory with no temporary files.
+
+    Get at it through a juce::SharedResourcePointer<SamplePool>; the pool lives
+    as long as anything holds one. Lookups are for the message thread (or a
+    loader thread), the audio thread only ever reads the Sample buffers.
+*/
+class SamplePool
+{
+public:
+    struct Sample : public juce::ReferenceCountedObject
+    {
+        using Ptr = juce::ReferenceCountedObjectPtr<Sample>;
+
+        juce::String name, hash;
+        juce::AudioBuffer<float> buffer;
+        double sampleRate = 44100.0;
+    };
+
+    SamplePool()
+    {
+        formatManager.registerBasicFormats();
+    }
+
+    /** Returns the decoded sample for some encoded audio data, decoding it on first use.
+        Returns nullptr if the data can't be read.
+    */
+    Sample::Ptr getSample (const void* data, size_t numBytes, const juce::String& name)
+    {
+        if (data == nullptr || numBytes == 0)
+            return {};
+
+        const auto hash = juce::MD5 (data, numBytes).toHexString();
+        const juce::ScopedLock sl (lock);
+
+        if (auto existing = samples.find (hash); existing != samples.end())
+            return existing->second;
+
+        std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (std::make_unique<juce::MemoryInputStream> (data, numBytes, false)));
+
+        if (reader == nullptr || reader->lengthInSamples <= 0)
+            return {};
+
+        Sample::Ptr sample (new Sample());
+        sample->name = name;
+        sample->hash = hash;
+        sample->sampleRate = reader->sampleRate;
+        sample->buffer.setSize ((int) reader->numChannels, (int) reader->lengthInSamples);
+        reader->read (&sample->buffer, 0, (int) reader->lengthInSamples, 0, true, true);
+
+        samples[hash] = sample;
+        return sample;
+    }
+
+    /** Reads a file and returns its sample. A file with the same contents as one
+        already in the pool shares its buffer.
+    */
+    Sample::Ptr getSample (const juce::File& file)
+    {
+        juce::MemoryBlock block;
+
+        if (! file.loadFileAsData (block))
+            return {};
+
+        return getSample (block.getData(), block.getSize(), file.getFileNameWithoutExtension());
+    }
+
+    /** Drops every sample nothing outside the pool is holding on to. */
+    void purgeUnused()
+    {
+        const juce::ScopedLock sl (lock);
+
+        for (auto i = samples.begin(); i != samples.end();)
+            i = i->second->getReferenceCount() == 1 ? samples.erase (i) : std::next (i);
+    }
+
+    int getNumSamples() const
+    {
+        const juce::ScopedLock sl (lock);
+        return (int) samples.size();
+    }
+
+    size_t getMemoryUsage() const
+    {
+        const juce::ScopedLock sl (lock);
+        size_t total = 0;
+
+        for (auto& s : samples)
+            total += (size_t) s.second->buffer.getNumChannels() * (size_t) s.second->buffer.getNumSamples() * sizeof (float);
+
+        return total;
+    }
+
+private:
+    juce::CriticalSection lock;
+    juce::AudioFormatManager formatManager;
+    std::map<juce::String, Sample::Ptr> samples;
+
+    JUCE_DECLARE_NON_COPYABLE (SamplePool)
+};
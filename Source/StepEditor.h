@@ -13,6 +13,7 @@
 #include "../includes/common/Components.h"
 #include "../includes/common/BinaryData.h"
 #include "../includes/common/Utilities.h"
+#include "StepPlayerPlugin.h"
 
 
 //============================================================================
@@ -21,25 +22,31 @@ namespace
 {
     static void loadFileIntoSamplerChannel (te::StepClip& clip, int channelIndex, const File& f)
     {
-        // Find SamplerPlugin for the Clip's Track
-        if (auto sampler = clip.getTrack()->pluginList.findFirstPluginOfType<te::SamplerPlugin>())
+        // Find the StepPlayerPlugin for the Clip's Track
+        if (auto player = clip.getTrack()->pluginList.findFirstPluginOfType<StepPlayerPlugin>())
         {
-            // Update the Sound layer source
-            sampler->setSoundMedia (channelIndex, f.getFullPathName());
+            // Decoded once into the shared pool, and shared with any channel already using the same file
+            SharedResourcePointer<SamplePool> pool;
 
-            // Then update the channel name
-            clip.getChannels()[channelIndex]->name = f.getFileNameWithoutExtension();
+            if (auto sample = pool->getSample (f))
+            {
+                player->setChannelSample (channelIndex, sample);
+
+                // Then update the channel name
+                clip.getChannels()[channelIndex]->name = f.getFileNameWithoutExtension();
+            }
         }
         else
         {
-            jassertfalse; // No SamplerPlugin added yet?
+            jassertfalse; // No StepPlayerPlugin added yet?
         }
     }
 }
 
 //============================================================================
 
-struct StepEditor: public juce::Component, private tracktion_engine::SelectableListener
+struct StepEditor: public juce::Component, private tracktion_engine::SelectableListener, private juce::ScrollBar::Listener,
+                   private FrameClock::Client
 {
     StepEditor(tracktion_engine::StepClip& sc)
     : clip(sc), transport(sc.edit.getTransport())
@@ -49,22 +56,40 @@ struct StepEditor: public juce::Component, private tracktion_engine::SelectableL
             addAndMakeVisible(channelConfigs.add(new ChannelConfig(*this, c->getIndex())));
         }
         
+        // Without a player the grid falls back to editing the clip's ValueTree directly
+        player = clip.getTrack()->pluginList.findFirstPluginOfType<StepPlayerPlugin>();
+        reloadPattern();
+        
         addAndMakeVisible(patternEditor);
-        timer.setCallback ([this] {patternEditor.updatePaths(); });
-        timer.startTimerHz(15);
+        addAndMakeVisible(scrollBar);
+        scrollBar.addListener(this);
         
         clip.addSelectableListener(this);
-        
+        frameClock->addClient(this);
     }
     
     ~StepEditor() override
     {
+        frameClock->removeClient (this);
         clip.removeSelectableListener (this);
     }
     
     tracktion_engine::StepClip::Pattern getPattern() const
     {
-        return clip.getPattern (0);
+        return clip.getPattern (patternIndex);
+    }
+    
+    int getPatternIndex() const noexcept { return patternIndex; }
+    
+    // Switches the grid (and the pattern the player loops) to another of the clip's patterns
+    void setPatternIndex(int newIndex)
+    {
+        if(newIndex == patternIndex || ! isPositiveAndBelow(newIndex, clip.getPatterns().size()))
+            return;
+        
+        commitSteps();
+        patternIndex = newIndex;
+        updatePaths();
     }
     
     void paint(Graphics&) override
@@ -74,17 +99,137 @@ struct StepEditor: public juce::Component, private tracktion_engine::SelectableL
     
     void updatePaths()
     {
-        patternEditor.resized();
+        reloadPattern();
+        patternEditor.updateLayout();
+    }
+    
+    void updateScrollBar()
+    {
+        scrollBar.setRangeLimits(0.0, patternEditor.getTotalWidth(), dontSendNotification);
+        scrollBar.setCurrentRange(patternEditor.getScrollX(), patternEditor.getWidth(), dontSendNotification);
+    }
+    
+    bool isStepOn(int channel, int index) const
+    {
+        if(player != nullptr)
+            return player->getPattern().getLatest().hasHit(channel, index);
+        
+        return getPattern().getNote(channel, index);
+    }
+    
+    BigInteger getChannelSteps(int channel) const
+    {
+        if(player != nullptr)
+            return player->getPattern().getLatest().getChannelBits(channel);
+        
+        return getPattern().getChannel(channel);
+    }
+    
+    // Goes straight to the player, the clip itself is only updated by commitSteps()
+    void setStep(int channel, int index, bool value)
+    {
+        if(player == nullptr)
+        {
+            getPattern().setNote(channel, index, value);
+            return;
+        }
+        
+        const auto& latest = player->getPattern().getLatest();
+        
+        // Only cells the clip really has, so commitSteps() never writes channels it hasn't got
+        if(! isPositiveAndBelow(channel, jmin(clip.getChannels().size(), latest.layout.numChannels))
+           || ! isPositiveAndBelow(index, latest.layout.numSteps)
+           || isStepOn(channel, index) == value)
+            return;
+        
+        // A channel's Euclidean generator overrides its drawn cells, so they can't be edited
+        if(latest.layout.channels[(size_t) channel].euclid.isActive())
+            return;
+        
+        player->getPattern().update([=] (StepPatternSnapshot& s) { s.setStep(channel, index, value); });
+        uncommittedChannels |= 1u << channel;
+        patternEditor.repaintCell(channel, index);
+    }
+    
+    StepGenerators::StepTrig getTrig(int channel, int index) const
+    {
+        if(player != nullptr)
+            return player->getPattern().getLatest().getTrig(channel, index);
+        
+        return {};
+    }
+    
+    // Trigs are sparse and rarely edited, so they're written back to the channel's state straight away
+    void setTrig(int channel, int index, StepGenerators::StepTrig trig)
+    {
+        if(player == nullptr || ! isPositiveAndBelow(channel, clip.getChannels().size()))
+            return;
+        
+        player->getPattern().update([=] (StepPatternSnapshot& s) { s.setTrig(channel, index, trig); });
+        
+        // setChannel() creates the channel's tree if the pattern has never had a note on it
+        auto pattern = getPattern();
+        
+        if(! pattern.state.getChild(channel).isValid())
+            pattern.setChannel(channel, pattern.getChannel(channel));
+        
+        const auto trigs = player->getPattern().getLatest().getTrigsString(channel);
+        pattern.state.getChild(channel).setProperty(StepPatternSnapshot::trigsID, trigs, nullptr);
+        patternEditor.repaintCell(channel, index);
     }
     
-    int getPatternWidth()
+    void showTrigMenu(int channel, int index)
     {
-        return patternEditor.getWidth();
+        if(player == nullptr || ! isPositiveAndBelow(channel, clip.getChannels().size()))
+            return;
+        
+        const auto trig = getTrig(channel, index);
+        PopupMenu probability, ratchets, conditions;
+        
+        for(int p : { 100, 75, 50, 25, 10 })
+            probability.addItem(String(p) + "%", true, trig.probability == p,
+                                [=] { auto t = getTrig(channel, index); t.probability = (uint8) p; setTrig(channel, index, t); });
+        
+        for(int r = 1; r <= 4; ++r)
+            ratchets.addItem(String(r), true, trig.ratchets == r,
+                             [=] { auto t = getTrig(channel, index); t.ratchets = (uint8) r; setTrig(channel, index, t); });
+        
+        for(int c = 0; c < (int) StepGenerators::Condition::numConditions; ++c)
+        {
+            const auto condition = (StepGenerators::Condition) c;
+            conditions.addItem(StepGenerators::getConditionName(condition), true, trig.condition == condition,
+                               [=] { auto t = getTrig(channel, index); t.condition = condition; setTrig(channel, index, t); });
+        }
+        
+        PopupMenu m;
+        m.addSubMenu("Probability", probability);
+        m.addSubMenu("Ratchet", ratchets);
+        m.addSubMenu("Condition", conditions);
+        m.addSeparator();
+        m.addItem("Reset", ! trig.isDefault(), false, [=] { setTrig(channel, index, {}); });
+        m.showMenuAsync({});
+    }
+    
+    // Writes the channels edited since the last commit back to the clip, once per gesture
+    void commitSteps()
+    {
+        if(player == nullptr || uncommittedChannels == 0)
+            return;
+        
+        const auto& latest = player->getPattern().getLatest();
+        auto pattern = getPattern();
+        
+        for(int i = 0; i < jmin(clip.getChannels().size(), StepPatternSnapshot::maxChannels); ++i)
+            if((uncommittedChannels & (1u << i)) != 0)
+                pattern.setChannel(i, latest.getChannelBits(i));
+        
+        uncommittedChannels = 0;
     }
     
     void resized()override
     {
-        auto r = getLocalBounds();
+        auto r = getGridBounds();
+        scrollBar.setBounds(getLocalBounds().removeFromBottom(scrollBarThickness).withTrimmedLeft(150));
         auto configR = r.removeFromLeft (150);
 
         for (auto c : channelConfigs)
@@ -108,6 +253,7 @@ struct StepEditor: public juce::Component, private tracktion_engine::SelectableL
             nameLabel.getTextValue().referTo(editor.clip.getChannels()[channelIndex]->name.getPropertyAsValue());
             loadButton.onClick =  [this] {browseForAndLoadSample(); };
             randomiseButton.onClick = [this] {randomiseChannel(); };
+            euclidButton.onClick = [this] {showEuclidMenu(); };
             
             volumeSlider.setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
             volumeSlider.setTextBoxStyle(Slider::NoTextBox, false, 0, 0);
@@ -123,10 +269,19 @@ struct StepEditor: public juce::Component, private tracktion_engine::SelectableL
             addAndMakeVisible(nameLabel);
             addAndMakeVisible(loadButton);
             addAndMakeVisible(randomiseButton);
+            addAndMakeVisible(euclidButton);
             addAndMakeVisible(volumeSlider);
             
-            
-            
+            updateEuclidState();
+        }
+        
+        // While the generator is on it decides the hits, so the drawn cells are locked
+        void updateEuclidState()
+        {
+            const auto active = StepGenerators::Euclid::fromValueTree(editor.clip.getChannels()[channelIndex]->state).isActive();
+            euclidButton.setToggleState(active, dontSendNotification);
+            euclidButton.setTooltip(active ? "Euclidean generator on, it overrides the drawn steps" : "Euclidean generator");
+            randomiseButton.setEnabled(! active);
         }
         
         void browseForAndLoadSample()
@@ -137,15 +292,49 @@ struct StepEditor: public juce::Component, private tracktion_engine::SelectableL
         
         void randomiseChannel()
         {
+            ChangeBatch::ScopedTransaction transaction;
             editor.getPattern().randomiseChannel(channelIndex);
         }
         
+        // Pulses of zero turns the generator off and goes back to the drawn steps
+        void showEuclidMenu()
+        {
+            auto channelState = editor.clip.getChannels()[channelIndex]->state;
+            const auto euclid = StepGenerators::Euclid::fromValueTree(channelState);
+            
+            auto setProperty = [this, channelState] (const Identifier& id, int value) mutable
+            {
+                channelState.setProperty(id, value, &editor.clip.edit.getUndoManager());
+                updateEuclidState();
+                editor.updatePaths();
+            };
+            
+            PopupMenu pulses, length, rotation;
+            pulses.addItem("Off", true, ! euclid.isActive(), [=] () mutable { setProperty(StepGenerators::Euclid::pulsesID, 0); });
+            
+            for(int i = 1; i <= euclid.length; ++i)
+                pulses.addItem(String(i), true, euclid.pulses == i, [=] () mutable { setProperty(StepGenerators::Euclid::pulsesID, i); });
+            
+            for(int i : { 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 16, 24, 32 })
+                length.addItem(String(i), true, euclid.length == i, [=] () mutable { setProperty(StepGenerators::Euclid::lengthID, i); });
+            
+            for(int i = 0; i < euclid.length; ++i)
+                rotation.addItem(String(i), true, euclid.rotation == i, [=] () mutable { setProperty(StepGenerators::Euclid::rotationID, i); });
+            
+            PopupMenu m;
+            m.addSubMenu("Pulses", pulses);
+            m.addSubMenu("Length", length);
+            m.addSubMenu("Rotation", rotation);
+            m.showMenuAsync(PopupMenu::Options().withTargetComponent(&euclidButton));
+        }
+        
         void resized() override
         {
             auto r = getLocalBounds();
             const int buttonH = roundToInt (r.getHeight() * 0.7);
             loadButton.setBounds (r.removeFromLeft (buttonH).reduced (2));
             randomiseButton.setBounds (r.removeFromLeft (buttonH).reduced (2));
+            euclidButton.setBounds (r.removeFromLeft (buttonH).reduced (2));
             volumeSlider.setBounds (r.removeFromLeft (r.getHeight()));
             nameLabel.setBounds (r.reduced (2));
         }
@@ -155,11 +344,17 @@ struct StepEditor: public juce::Component, private tracktion_engine::SelectableL
         const int channelIndex;
         ShapeButton loadButton {"L", Colours::white, Colours::white, Colours::white};
         ShapeButton randomiseButton {"R", Colours::white, Colours::white, Colours::white};
+        TextButton euclidButton {"E"};
         Label nameLabel;
         Slider volumeSlider;
     };
     
     //------------------------------------------------------------------------
+    /*
+        The grid is virtual: steps have a uniform width and a scroll offset, so
+        every position is worked out on the fly and only the steps inside the
+        visible area are ever laid out or painted, however long the pattern is.
+    */
     struct PatternEditor : public juce::Component
     {
         
@@ -169,101 +364,162 @@ struct StepEditor: public juce::Component, private tracktion_engine::SelectableL
             
         }
         
-        void updatePaths()
+        // Called every frame, so it only repaints the columns the playhead left and entered
+        bool updatePlayhead (FrameClock::Frame& frame)
         {
-            playheadRect = {};
-            grid.clear();
-            activeCells.clear();
-            playingCells.clear();
-
-            const auto pattern (editor.clip.getPattern (0));
-            const int numChans = editor.clip.getChannels().size();
-            const float indent = 2.0f;
-
             const bool isPlaying = editor.transport.isPlaying();
-            const float playheadX = getPlayheadX();
+            const int newPlayheadIndex = getPlayheadIndex (frame.getPosition (editor.transport));
 
-            for (int i = 0; i < numChans; ++i)
-            {
-                const BigInteger cache (pattern.getChannel (i));
-                const Range<float> y (editor.getChannelYRange (i));
-                int index = 0;
-                float lastX = 0.0f;
+            if (newPlayheadIndex == playheadIndex && isPlaying == wasPlaying)
+                return false;
 
-                grid.addWithoutMerging ({ 0.0f, y.getStart() - 0.25f, (float) getWidth(), 0.5f });
+            repaintColumn (playheadIndex);
+            repaintColumn (newPlayheadIndex);
 
-                for (float x : noteXes)
-                {
-                    if (cache[index])
-                    {
-                        Path& path = (isPlaying && playheadX >= lastX && playheadX < x)
-                                         ? playingCells : activeCells;
+            playheadIndex = newPlayheadIndex;
+            wasPlaying = isPlaying;
 
-                        const Rectangle<float> r (lastX, (float) y.getStart(), x - lastX, (float) y.getLength());
-                        path.addRoundedRectangle (r.reduced (jlimit (0.5f, indent, r.getWidth()  / 8.0f),
-                                                             jlimit (0.5f, indent, r.getHeight() / 8.0f)), 2.0f);
-                    }
+            // Page along with the playhead when it runs off the visible steps
+            if (isPlaying && playheadIndex >= 0)
+            {
+                const Range<float> x = getSequenceIndexXRange (playheadIndex);
 
-                    lastX = x;
-                    ++index;
-                }
+                if (x.getStart() < 0.0f || x.getEnd() > getWidth())
+                    setScrollX (playheadIndex * (double) stepWidth);
             }
+            
+            return true;
+        }
+        
+        // Picks up a new step count from the clip
+        void updateLayout()
+        {
+            numSteps = editor.getPattern().getNumNotes();
 
-            // Add the vertical lines
-            for (float x : noteXes)
-                grid.addWithoutMerging ({ x - 0.25f, 0.0f, 0.5f, (float) getHeight() });
+            if (! hasBeenZoomed)
+                stepWidth = jmax (minStepWidth, getWidth() / (float) stepsPerBar);
 
-            // Add the missing right and bottom edges
-            {
-                auto r = getLocalBounds().toFloat();
-                grid.addWithoutMerging (r.removeFromBottom (0.5f).translated (0.0f, -0.25f));
-                grid.addWithoutMerging (r.removeFromLeft (0.5f).translated (-0.25f, 0.0f));
-            }
+            gridImage = {};
+            playheadIndex = getPlayheadIndex();
+            setScrollX (scrollX);
+            editor.updateScrollBar();
+            repaint();
+        }
+        
+        void repaintCell (int channel, int index)
+        {
+            repaint (getCellBounds (channel, index).getSmallestIntegerContainer().expanded (2));
+        }
+        
+        double getScrollX() const noexcept      { return scrollX; }
+        double getTotalWidth() const noexcept   { return numSteps * (double) stepWidth; }
+        
+        void setScrollX (double newScrollX)
+        {
+            newScrollX = jlimit (0.0, jmax (0.0, getTotalWidth() - getWidth()), newScrollX);
 
-            // Calculate playhead rect
+            if (newScrollX != scrollX)
             {
-                auto r = getLocalBounds().toFloat();
-                float lastX = 0.0f;
-
-                for (float x : noteXes)
-                {
-                    if (playheadX >= lastX && playheadX < x)
-                    {
-                        playheadRect = r.withX (lastX).withRight (x);
-                        break;
-                    }
-
-                    lastX = x;
-                }
+                scrollX = newScrollX;
+                editor.updateScrollBar();
+                repaint();
             }
+        }
+        
+        // Zooms around anchorX, keeping the step under it in place
+        void setStepWidth (float newStepWidth, float anchorX)
+        {
+            newStepWidth = jlimit (minStepWidth, maxStepWidth, newStepWidth);
 
+            if (newStepWidth == stepWidth)
+                return;
+
+            const auto anchorStep = (anchorX + scrollX) / stepWidth;
+            stepWidth = newStepWidth;
+            hasBeenZoomed = true;
+            gridImage = {};
+            scrollX = jlimit (0.0, jmax (0.0, getTotalWidth() - getWidth()), anchorStep * stepWidth - anchorX);
+            editor.updateScrollBar();
             repaint();
         }
         
         void paint(Graphics &g) override
         {
-            g.setColour (Colours::white.withMultipliedAlpha (0.5f));
-            g.fillRectList (grid);
+            const auto patternRight = (float) (getTotalWidth() - scrollX);
 
-            g.setColour (Colours::white.withMultipliedAlpha (0.7f));
-            g.fillPath (activeCells);
+            {
+                // The grid repeats every step, so one cached strip is just slid along
+                Graphics::ScopedSaveState state (g);
+                g.reduceClipRegion (Rectangle<float> (0.0f, 0.0f, patternRight + 0.25f, (float) getHeight()).getSmallestIntegerContainer());
+
+                if (gridImage.isNull())
+                    renderGridImage();
 
-            g.setColour (Colours::white);
-            g.fillPath (playingCells);
+                const auto phase = (float) std::fmod (scrollX, (double) stepWidth);
+                g.drawImageTransformed (gridImage, AffineTransform::translation (-phase, 0.0f));
+            }
 
             g.setColour (Colours::white.withMultipliedAlpha (0.5f));
-            g.fillRect (playheadRect);
+            g.fillRect (Rectangle<float> (patternRight - 0.25f, 0.0f, 0.5f, (float) getHeight()));
+
+            // Only the cells inside the area being repainted are looked at
+            const auto dirty = g.getClipBounds().toFloat();
+            const int numChans = editor.clip.getChannels().size();
+            const int firstIndex = jmax (0, xToSequenceIndex (dirty.getX()));
+            const int lastIndex = xToSequenceIndex (dirty.getRight() - 0.001f);
+            const int endIndex = lastIndex < 0 ? numSteps : lastIndex + 1;
+            const bool isPlaying = editor.transport.isPlaying();
+
+            for (int i = jmax (0, editor.yToChannel (dirty.getY())); i < numChans; ++i)
+            {
+                const Range<float> y (editor.getChannelYRange (i));
+
+                if (y.getStart() >= dirty.getBottom())
+                    break;
+
+                for (int index = firstIndex; index < endIndex; ++index)
+                {
+                    if (! editor.isStepOn (i, index))
+                        continue;
+
+                    // Fainter the less likely it is to play, split up for ratchets, dotted when conditional
+                    const auto trig = editor.getTrig (i, index);
+                    const bool isPlayingCell = isPlaying && index == playheadIndex;
+                    const auto alpha = (isPlayingCell ? 1.0f : 0.7f) * jmap (trig.probability / 100.0f, 0.25f, 1.0f);
+                    g.setColour (Colours::white.withMultipliedAlpha (alpha));
+
+                    const auto r = getCellBounds (i, index);
+                    const auto cell = r.reduced (jlimit (0.5f, cellIndent, r.getWidth()  / 8.0f),
+                                                 jlimit (0.5f, cellIndent, r.getHeight() / 8.0f));
+                    g.fillRoundedRectangle (cell, 2.0f);
+
+                    if (trig.ratchets > 1 || trig.condition != StepGenerators::Condition::always)
+                    {
+                        g.setColour (Colours::black.withMultipliedAlpha (0.6f));
+
+                        for (int n = 1; n < trig.ratchets; ++n)
+                            g.fillRect (Rectangle<float> (cell.getX() + cell.getWidth() * n / trig.ratchets - 0.5f, cell.getY(), 1.0f, cell.getHeight()));
+
+                        if (trig.condition != StepGenerators::Condition::always)
+                            g.fillEllipse (Rectangle<float> (3.0f, 3.0f).withCentre (cell.getTopRight().translated (-3.0f, 3.0f)));
+                    }
+                }
+            }
+
+            if (playheadIndex >= 0)
+            {
+                const Range<float> x = getSequenceIndexXRange (playheadIndex);
+                g.setColour (Colours::white.withMultipliedAlpha (0.5f));
+                g.fillRect (Rectangle<float> (x.getStart(), 0.0f, x.getLength(), (float) getHeight()));
+            }
 
-            const Range<float> x = getSequenceIndexXRange (mouseOverCellIndex);
-            const Range<float> y = editor.getChannelYRange (mouseOverChannel);
             g.setColour (Colours::red);
-            g.drawRect (Rectangle<float>::leftTopRightBottom (x.getStart(), y.getStart(), x.getEnd(), y.getEnd()), 2.0f);
+            g.drawRect (getCellBounds (mouseOverChannel, mouseOverCellIndex), 2.0f);
         }
         
         void resized() override
         {
-            updateNoteXes();
-            updatePaths();
+            updateLayout();
         }
         
         void mouseEnter(const MouseEvent& e) override
@@ -280,96 +536,163 @@ struct StepEditor: public juce::Component, private tracktion_engine::SelectableL
         {
             updateNoteUnderMouse (e);
 
+            if (e.mods.isPopupMenu())
+            {
+                editor.showTrigMenu (mouseOverChannel, mouseOverCellIndex);
+                return;
+            }
+
             paintSolidCells = true;
 
             if (e.mods.isCtrlDown() || e.mods.isCommandDown())
                 paintSolidCells = false;
             else if (! e.mods.isShiftDown())
-                paintSolidCells = ! editor.clip.getPattern (0).getNote (mouseOverChannel, mouseOverCellIndex);
+                paintSolidCells = ! editor.isStepOn (mouseOverChannel, mouseOverCellIndex);
 
             setCellAtLastMousePosition (paintSolidCells);
         }
         
         void mouseDrag(const MouseEvent& e) override
         {
+            if (e.mods.isPopupMenu())
+                return;
+
             updateNoteUnderMouse (e);
             setCellAtLastMousePosition (paintSolidCells);
         }
         
+        void mouseUp(const MouseEvent&) override
+        {
+            editor.commitSteps();
+        }
+        
         void mouseExit(const MouseEvent&) override
         {
             setNoteUnderMouse (-1, -1);
         }
         
+        // Scrolls, or zooms with cmd/ctrl held
+        void mouseWheelMove (const MouseEvent& e, const MouseWheelDetails& wheel) override
+        {
+            if (e.mods.isCommandDown() || e.mods.isCtrlDown())
+                setStepWidth (stepWidth * std::pow (2.0f, wheel.deltaY * 2.0f), (float) e.x);
+            else
+                setScrollX (scrollX - (wheel.deltaX != 0.0f ? wheel.deltaX : wheel.deltaY) * getWidth() * 0.5);
+
+            updateNoteUnderMouse (e);
+        }
+        
+        void mouseMagnify (const MouseEvent& e, float scaleFactor) override
+        {
+            setStepWidth (stepWidth * scaleFactor, (float) e.x);
+            updateNoteUnderMouse (e);
+        }
+        
     private:
         
         StepEditor& editor;
-        Array<float> noteXes;
-        RectangleList<float> grid;
-        Path activeCells, playingCells;
-        Rectangle<float> playheadRect;
+        Image gridImage;
+        
+        int numSteps = 0;
+        float stepWidth = 16.0f;
+        double scrollX = 0.0;
+        bool hasBeenZoomed = false;
         
+        int playheadIndex = -1;
+        bool wasPlaying = false;
         int mouseOverCellIndex = -1, mouseOverChannel = -1;
         bool paintSolidCells = true;
         
-        void updateNoteXes()
+        static constexpr float cellIndent = 2.0f;
+        static constexpr float minStepWidth = 4.0f, maxStepWidth = 120.0f;
+        static constexpr int stepsPerBar = 16;
+        
+        // One step wider than the component, so it can be slid by up to a step either way
+        void renderGridImage()
         {
-            noteXes.clearQuick();
+            const int w = getWidth() + (int) std::ceil (stepWidth) + 1;
+
+            if (w <= 0 || getHeight() <= 0)
+            {
+                gridImage = {};
+                return;
+            }
+
+            gridImage = Image (Image::ARGB, w, getHeight(), true);
+            Graphics g (gridImage);
+            g.setColour (Colours::white.withMultipliedAlpha (0.5f));
 
-            auto r = getLocalBounds().toFloat();
-            const auto pattern (editor.clip.getPattern (0));
-            const int numNotes = pattern.getNumNotes();
-            const float w = r.getWidth() / std::max (1, numNotes);
+            RectangleList<float> grid;
+            const int numChans = editor.clip.getChannels().size();
+
+            for (int i = 0; i < numChans; ++i)
+                grid.addWithoutMerging ({ 0.0f, editor.getChannelYRange (i).getStart() - 0.25f, (float) w, 0.5f });
+
+            for (int i = 0; i * stepWidth - 0.25f < w; ++i)
+                grid.addWithoutMerging ({ i * stepWidth - 0.25f, 0.0f, 0.5f, (float) getHeight() });
+
+            grid.addWithoutMerging ({ 0.0f, getHeight() - 0.5f, (float) w, 0.5f });
+            g.fillRectList (grid);
+        }
+        
+        void repaintColumn (int index)
+        {
+            const Range<float> x = getSequenceIndexXRange (index);
 
-            for (int i = 0; i < numNotes; ++i)
-                noteXes.add ((i + 1) * w);
+            if (! x.isEmpty())
+                repaint (Rectangle<float> (x.getStart(), 0.0f, x.getLength(), (float) getHeight()).getSmallestIntegerContainer().expanded (1, 0));
+        }
+        
+        Rectangle<float> getCellBounds (int channel, int index) const
+        {
+            const Range<float> x = getSequenceIndexXRange (index);
+            const Range<float> y = editor.getChannelYRange (channel);
+            return Rectangle<float>::leftTopRightBottom (x.getStart(), y.getStart(), x.getEnd(), y.getEnd());
         }
         
-        float getPlayheadX() const
+        int getPlayheadIndex() const
+        {
+            return getPlayheadIndex (editor.transport.position);
+        }
+        
+        int getPlayheadIndex (double position) const
         {
             auto clipRange = editor.clip.getEditTimeRange();
 
-            if (clipRange.isEmpty())
-                return 0.0f;
+            if (clipRange.isEmpty() || numSteps == 0)
+                return -1;
 
-            const double position = editor.transport.position;
             const auto proportion = position / clipRange.getEnd();
-            auto r = getLocalBounds().toFloat();
+            const auto index = (int) std::floor (proportion * numSteps);
 
-            return r.getWidth() * float (proportion);
-            
+            return isPositiveAndBelow (index, numSteps) ? index : -1;
         }
         
         int xToSequenceIndex(float x) const
         {
-            if (x >= 0)
-                for (int i = 0; i < noteXes.size(); ++i)
-                    if (x < noteXes.getUnchecked (i))
-                        return i;
+            if (x < 0)
+                return -1;
 
-            return -1;
-            
+            const auto index = (int) std::floor ((x + scrollX) / stepWidth);
+            return index < numSteps ? index : -1;
         }
         Range<float> getSequenceIndexXRange(int index) const
         {
-            if (! isPositiveAndBelow (index, noteXes.size()) || noteXes.size() <= 2)
+            if (! isPositiveAndBelow (index, numSteps))
                 return {};
 
-            if (index == 0)
-                return { 0.0f, noteXes.getUnchecked (index) };
-
-            return { noteXes.getUnchecked (index - 1), noteXes.getUnchecked (index) };
-            
+            const auto start = (float) (index * (double) stepWidth - scrollX);
+            return { start, start + stepWidth };
         }
         
         bool setNoteUnderMouse (int newIndex, int newChannel)
         {
             if (newIndex != mouseOverCellIndex || newChannel != mouseOverChannel)
             {
+                repaintCell (mouseOverChannel, mouseOverCellIndex);
                 mouseOverCellIndex = newIndex;
                 mouseOverChannel = newChannel;
-                resized();
-                repaint();
+                repaintCell (mouseOverChannel, mouseOverCellIndex);
                 return true;
             }
 
@@ -384,7 +707,7 @@ struct StepEditor: public juce::Component, private tracktion_engine::SelectableL
         
         void setCellAtLastMousePosition(bool value)
         {
-            editor.clip.getPattern (0).setNote (mouseOverChannel, mouseOverCellIndex, value);
+            editor.setStep (mouseOverChannel, mouseOverCellIndex, value);
         }
         
     };
@@ -393,28 +716,46 @@ private:
     //----------------------PRIVATE VARIABLES HERE---------------------------
     tracktion_engine::StepClip& clip;
     tracktion_engine::TransportControl& transport;
-    tracktion_engine::LambdaTimer timer;
+    juce::SharedResourcePointer<FrameClock> frameClock;
+    
+    juce::ReferenceCountedObjectPtr<StepPlayerPlugin> player;
+    juce::uint32 uncommittedChannels = 0;
+    int patternIndex = 0;
     
     OwnedArray<ChannelConfig> channelConfigs;
     PatternEditor patternEditor {*this};
     
     
     TextButton stepPlayButton {"Play"};
+    ScrollBar scrollBar {false};
+    
+    static constexpr int scrollBarThickness = 10;
+    
+    bool updateFrame (FrameClock::Frame& frame) override
+    {
+        return patternEditor.updatePlayhead (frame);
+    }
+    
+    Rectangle<int> getGridBounds() const
+    {
+        return getLocalBounds().withTrimmedBottom(scrollBarThickness);
+    }
     
     int yToChannel (float y) const
     {
-        auto r = getLocalBounds().toFloat();
+        auto r = getGridBounds().toFloat();
         const int numChans = clip.getChannels().size();
 
         if (r.isEmpty())
             return -1;
 
-        return (int) std::floor (y / r.getHeight() * numChans);
+        const auto channel = (int) std::floor (y / r.getHeight() * numChans);
+        return isPositiveAndBelow (channel, numChans) ? channel : -1;
     }
     
     Range<float> getChannelYRange(int channelIndex) const
     {
-        auto r = getLocalBounds().toFloat();
+        auto r = getGridBounds().toFloat();
         const int numChans = clip.getChannels().size();
 
         if (numChans == 0)
@@ -424,10 +765,23 @@ private:
 
         return Range<float>::withStartAndLength (channelIndex * h, h);    }
     
+    void reloadPattern()
+    {
+        // Mid-gesture the player is ahead of the clip, so leave it alone until the commit
+        if(player != nullptr && uncommittedChannels == 0)
+            player->loadFromClip(clip, patternIndex);
+    }
+    
     void selectableObjectChanged(tracktion_engine::Selectable*) override
     {
         // This is our StepClip telling us that one of it's properties has changed
-        patternEditor.updatePaths();
+        reloadPattern();
+        patternEditor.updateLayout();
+    }
+    
+    void scrollBarMoved(ScrollBar*, double newRangeStart) override
+    {
+        patternEditor.setScrollX(newRangeStart);
     }
     
     void selectableObjectAboutToBeDeleted(tracktion_engine::Selectable*)override
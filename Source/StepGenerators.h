@@ -0,0 +1,146 @@
+/*
+  ==============================================================================
+
+    StepGenerators.h
+    Created: 19 Oct 2026 8:02:16pm
+    Author:  Samuel Chadri
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    The pieces the step player uses to make each pass of a pattern different.
+    All of it is plain arithmetic on fixed-size values so it can run on the
+    audio thread, and every random decision is a pure function of the seed and
+    where it's being made, so a bounce always comes out the same.
+*/
+namespace StepGenerators
+{
+    //==============================================================================
+    /** Evenly spread hits, the same result Bjorklund's algorithm gives (up to rotation). */
+    struct Euclid
+    {
+        int pulses = 0, length = 16, rotation = 0;   // No pulses means the drawn pattern is used
+
+        bool isActive() const noexcept      { return pulses > 0 && length > 0; }
+
+        bool isHit (juce::int64 step) const noexcept
+        {
+            const auto i = ((step + rotation) % length + length) % length;
+            return (i * pulses) % length < pulses;
+        }
+
+        static inline const juce::Identifier pulsesID { "euclidPulses" }, lengthID { "euclidLength" }, rotationID { "euclidRotation" };
+
+        static Euclid fromValueTree (const juce::ValueTree& v)
+        {
+            Euclid e;
+            e.length = juce::jlimit (1, 64, (int) v.getProperty (lengthID, 16));
+            e.pulses = juce::jlimit (0, e.length, (int) v.getProperty (pulsesID, 0));
+            e.rotation = juce::jlimit (0, e.length - 1, (int) v.getProperty (rotationID, 0));
+            return e;
+        }
+    };
+
+    //==============================================================================
+    /** Conditional trigs: which passes through the pattern a step plays on. */
+    enum class Condition : juce::uint8
+    {
+        always,
+        oneOfTwo, twoOfTwo,
+        oneOfThree, twoOfThree, threeOfThree,
+        oneOfFour, twoOfFour, threeOfFour, fourOfFour,
+        firstOnly, notFirst,
+        numConditions
+    };
+
+    inline juce::String getConditionName (Condition c)
+    {
+        static const char* names[] = { "Always", "1:2", "2:2", "1:3", "2:3", "3:3",
+                                       "1:4", "2:4", "3:4", "4:4", "First", "Not First" };
+        return names[juce::jlimit (0, (int) Condition::numConditions - 1, (int) c)];
+    }
+
+    inline bool isConditionMet (Condition c, juce::int64 pass) noexcept
+    {
+        auto nOfM = [pass] (int n, int m) { return pass % m == n - 1; };
+
+        switch (c)
+        {
+            case Condition::oneOfTwo:       return nOfM (1, 2);
+            case Condition::twoOfTwo:       return nOfM (2, 2);
+            case Condition::oneOfThree:     return nOfM (1, 3);
+            case Condition::twoOfThree:     return nOfM (2, 3);
+            case Condition::threeOfThree:   return nOfM (3, 3);
+            case Condition::oneOfFour:      return nOfM (1, 4);
+            case Condition::twoOfFour:      return nOfM (2, 4);
+            case Condition::threeOfFour:    return nOfM (3, 4);
+            case Condition::fourOfFour:     return nOfM (4, 4);
+            case Condition::firstOnly:      return pass == 0;
+            case Condition::notFirst:       return pass != 0;
+            case Condition::always:
+            case Condition::numConditions:
+            default:                        return true;
+        }
+    }
+
+    //==============================================================================
+    /** What a single cell does beyond being on or off, packed into two bytes. */
+    struct StepTrig
+    {
+        juce::uint8 probability = 100;  // Percent
+        juce::uint8 ratchets = 1;       // Hits within the step, 1 to 4
+        Condition condition = Condition::always;
+
+        bool isDefault() const noexcept   { return probability == 100 && ratchets == 1 && condition == Condition::always; }
+
+        juce::uint16 pack() const noexcept
+        {
+            return (juce::uint16) (probability | ((ratchets - 1) & 3) << 7 | (int) condition << 9);
+        }
+
+        static StepTrig unpack (juce::uint16 v) noexcept
+        {
+            StepTrig t;
+            t.probability = (juce::uint8) juce::jmin (100, v & 0x7f);
+            t.ratchets = (juce::uint8) (((v >> 7) & 3) + 1);
+            t.condition = (Condition) juce::jmin ((int) Condition::numConditions - 1, v >> 9);
+            return t;
+        }
+
+        static constexpr juce::uint16 defaultPacked = 100;
+    };
+
+    //==============================================================================
+    /** A stateless random number in [0, 1) for one decision. Nothing is carried from
+        call to call, so the result doesn't depend on where playback or a render started.
+    */
+    inline float getRandom (juce::uint32 seed, juce::int64 pass, int channel, juce::int64 step) noexcept
+    {
+        auto x = (juce::uint64) seed * 0x9e3779b97f4a7c15ull
+                 ^ (juce::uint64) pass * 0xbf58476d1ce4e5b9ull
+                 ^ (juce::uint64) (channel + 1) * 0x94d049bb133111ebull
+                 ^ (juce::uint64) step;
+
+        // splitmix64 finaliser
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        x ^= x >> 31;
+
+        return (float) (x >> 40) / 16777216.0f;
+    }
+
+    /** Whether a hit with these trig settings plays on the given pass. */
+    inline bool shouldPlay (StepTrig trig, juce::uint32 seed, juce::int64 pass, int channel, juce::int64 step) noexcept
+    {
+        if (! isConditionMet (trig.condition, pass))
+            return false;
+
+        return trig.probability >= 100 || getRandom (seed, pass, channel, step) * 100.0f < trig.probability;
+    }
+}
@@ -0,0 +1,374 @@
+/*
+  ==============================================================================
+
+    StepGroove.h
+    Created: 19 Oct 2026 7:11:52pm
+    Author:  Samuel Chadri
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+    A groove learned from a played part: for each step of a repeating cycle,
+    how early or late the hits were (in steps) and how loud they were relative
+    to the part's average.
+*/
+struct GrooveTemplate
+{
+    static constexpr int maxLength = 64;
+
+    int length = 0;     // Zero means no template
+    std::array<float, maxLength> timing {}, velocity {};
+
+    bool isEmpty() const noexcept       { return length == 0; }
+
+    juce::String toString() const
+    {
+        juce::StringArray values;
+
+        for (int i = 0; i < length; ++i)
+            values.add (juce::String (timing[(size_t) i], 4) + ":" + juce::String (velocity[(size_t) i], 3));
+
+        return values.joinIntoString (" ");
+    }
+
+    static GrooveTemplate fromString (const juce::String& s)
+    {
+        GrooveTemplate t;
+        auto values = juce::StringArray::fromTokens (s, " ", {});
+
+        for (auto& v : values)
+        {
+            if (t.length >= maxLength)
+                break;
+
+            t.timing[(size_t) t.length] = v.upToFirstOccurrenceOf (":", false, false).getFloatValue();
+            t.velocity[(size_t) t.length] = v.fromFirstOccurrenceOf (":", false, false).getFloatValue();
+            ++t.length;
+        }
+
+        return t;
+    }
+
+    //==============================================================================
+    /** Averages hit positions (in beats) and levels onto a cycle of the given number of steps. */
+    static GrooveTemplate fromHits (const juce::Array<std::pair<double, float>>& hits, double stepLengthBeats, int numSteps)
+    {
+        GrooveTemplate t;
+
+        if (hits.isEmpty() || stepLengthBeats <= 0.0)
+            return t;
+
+        t.length = juce::jlimit (1, maxLength, numSteps);
+
+        std::array<double, maxLength> timingSum {}, levelSum {};
+        std::array<int, maxLength> counts {};
+        double totalLevel = 0.0;
+
+        for (auto& hit : hits)
+        {
+            const auto position = hit.first / stepLengthBeats;
+            const auto nearest = std::round (position);
+            const auto index = (size_t) (((juce::int64) nearest % t.length + t.length) % t.length);
+
+            timingSum[index] += position - nearest;
+            levelSum[index] += hit.second;
+            counts[index]++;
+            totalLevel += hit.second;
+        }
+
+        const auto averageLevel = totalLevel / hits.size();
+
+        for (size_t i = 0; i < (size_t) t.length; ++i)
+        {
+            t.timing[i] = counts[i] > 0 ? (float) (timingSum[i] / counts[i]) : 0.0f;
+            t.velocity[i] = counts[i] > 0 && averageLevel > 0.0 ? (float) (levelSum[i] / counts[i] / averageLevel) : 1.0f;
+        }
+
+        return t;
+    }
+
+    /** Learns a groove from the notes of a MIDI clip. */
+    static GrooveTemplate fromMidiClip (tracktion_engine::MidiClip& clip, double stepLengthBeats, int numSteps = 16)
+    {
+        juce::Array<std::pair<double, float>> hits;
+
+        for (auto note : clip.getSequence().getNotes())
+            hits.add ({ note->getStartBeat(), (float) note->getVelocity() });
+
+        return fromHits (hits, stepLengthBeats, numSteps);
+    }
+
+    /** Any thread. Finds the onsets in part of an audio file with a simple energy-rise
+        detector, as (seconds from the start of the part, energy) pairs. This decodes
+        the whole part, so keep it off the message thread (see GrooveLearner).
+    */
+    static juce::Array<std::pair<double, float>> findOnsets (const juce::File& file, double offsetSeconds, double lengthSeconds,
+                                                            std::function<bool()> shouldExit)
+    {
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+
+        std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (file));
+        juce::Array<std::pair<double, float>> hits;
+
+        if (reader == nullptr || reader->sampleRate <= 0.0)
+            return hits;
+
+        const int hopSize = 512;
+        const auto minGapHops = juce::jmax (1, juce::roundToInt (reader->sampleRate * 0.05 / hopSize));
+        const auto startSample = (juce::int64) (offsetSeconds * reader->sampleRate);
+        const auto endSample = juce::jmin (reader->lengthInSamples, startSample + (juce::int64) (lengthSeconds * reader->sampleRate));
+
+        juce::AudioBuffer<float> block ((int) reader->numChannels, hopSize);
+        std::array<float, 8> history {};
+        float previous = 0.0f;
+        int hopsSinceOnset = minGapHops;
+        size_t historyIndex = 0;
+
+        for (auto pos = startSample; pos + hopSize <= endSample; pos += hopSize)
+        {
+            if (shouldExit())
+                return {};
+
+            reader->read (&block, 0, hopSize, pos, true, true);
+
+            float energy = 0.0f;
+
+            for (int c = 0; c < block.getNumChannels(); ++c)
+                energy += block.getRMSLevel (c, 0, hopSize);
+
+            float average = 0.0f;
+
+            for (auto h : history)
+                average += h;
+
+            average /= (float) history.size();
+
+            if (++hopsSinceOnset > minGapHops && energy > 0.01f && energy > average * 1.5f && energy > previous)
+            {
+                hits.add ({ (double) (pos - startSample) / reader->sampleRate, energy });
+                hopsSinceOnset = 0;
+            }
+
+            history[historyIndex] = energy;
+            historyIndex = (historyIndex + 1) % history.size();
+            previous = energy;
+        }
+
+        return hits;
+    }
+};
+
+//==============================================================================
+/*
+    Learns groove templates from audio clips on a background thread, since that
+    means decoding the clip's audio. The onsets come back as times and are turned
+    into beats on the message thread, which is the only place the clip and its
+    tempo map can be touched. Only the latest request is ever answered.
+*/
+class GrooveLearner
+{
+public:
+    GrooveLearner() = default;
+
+    ~GrooveLearner()
+    {
+        pool.removeAllJobs (true, 5000);
+    }
+
+    using Callback = std::function<void (const GrooveTemplate&)>;
+
+    /** Message thread. onLearnt is called on the message thread when it's done, unless
+        this is cancelled or deleted first, or the clip is deleted meanwhile.
+    */
+    void learnFromAudioClip (tracktion_engine::WaveAudioClip& clip, double stepLengthBeats, Callback onLearnt, int numSteps = 16)
+    {
+        cancel();
+
+        const auto position = clip.getPosition();
+        auto job = std::make_unique<OnsetJob> (clip.getAudioFile().getFile(), position.getOffset(), position.getLength());
+
+        job->onFinished = [weakThis = juce::WeakReference<GrooveLearner> (this), clipRef = tracktion_engine::Selectable::WeakRef (&clip),
+                           generation = generation, position, stepLengthBeats, numSteps, onLearnt] (juce::Array<std::pair<double, float>> onsets)
+        {
+            juce::MessageManager::callAsync ([=]
+            {
+                auto c = dynamic_cast<tracktion_engine::WaveAudioClip*> (clipRef.get());
+
+                if (weakThis == nullptr || weakThis->generation != generation || c == nullptr)
+                    return;
+
+                juce::Array<std::pair<double, float>> hits;
+
+                for (auto& onset : onsets)
+                    hits.add ({ c->edit.tempoSequence.timeToBeats (position.getStart() + onset.first) - c->getStartBeat(), onset.second });
+
+                onLearnt (GrooveTemplate::fromHits (hits, stepLengthBeats, numSteps));
+            });
+        };
+
+        pool.addJob (job.release(), true);
+    }
+
+    /** Message thread. Drops any request still in progress. */
+    void cancel()
+    {
+        ++generation;
+        pool.removeAllJobs (true, 0);
+    }
+
+private:
+    struct OnsetJob  : public juce::ThreadPoolJob
+    {
+        OnsetJob (const juce::File& f, double offset, double length)
+            : ThreadPoolJob ("Groove onsets"), file (f), offsetSeconds (offset), lengthSeconds (length)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            auto onsets = GrooveTemplate::findOnsets (file, offsetSeconds, lengthSeconds, [this] { return shouldExit(); });
+
+            if (! shouldExit())
+                onFinished (std::move (onsets));
+
+            return jobHasFinished;
+        }
+
+        juce::File file;
+        double offsetSeconds, lengthSeconds;
+        std::function<void (juce::Array<std::pair<double, float>>)> onFinished;
+    };
+
+    juce::ThreadPool pool { 1 };
+    int generation = 0;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (GrooveLearner)
+    JUCE_DECLARE_NON_COPYABLE (GrooveLearner)
+};
+
+//==============================================================================
+/** Everything the user sets for the groove. Kept in the step player's state. */
+struct GrooveSettings
+{
+    float swing = 50.0f;            // Percent, 50 is straight and 66.7 a triplet shuffle
+    float timingHumanise = 0.0f;    // Largest random shift, as a fraction of a step
+    float velocityHumanise = 0.0f;  // Largest random level change, 0 to 1
+    float templateAmount = 1.0f;
+    int seed = 1;
+    GrooveTemplate groove;
+
+    static inline const juce::Identifier grooveID { "GROOVE" };
+
+    juce::ValueTree toValueTree() const
+    {
+        return juce::ValueTree (grooveID, { { "swing", swing }, { "timingHumanise", timingHumanise },
+                                            { "velocityHumanise", velocityHumanise }, { "templateAmount", templateAmount },
+                                            { "seed", seed }, { "template", groove.toString() } });
+    }
+
+    static GrooveSettings fromValueTree (const juce::ValueTree& v)
+    {
+        GrooveSettings s;
+
+        if (! v.hasType (grooveID))
+            return s;
+
+        s.swing = v.getProperty ("swing", s.swing);
+        s.timingHumanise = v.getProperty ("timingHumanise", s.timingHumanise);
+        s.velocityHumanise = v.getProperty ("velocityHumanise", s.velocityHumanise);
+        s.templateAmount = v.getProperty ("templateAmount", s.templateAmount);
+        s.seed = v.getProperty ("seed", s.seed);
+        s.groove = GrooveTemplate::fromString (v.getProperty ("template").toString());
+        return s;
+    }
+};
+
+//==============================================================================
+/*
+    The groove worked out for every channel and every step of a cycle, so the
+    audio thread just looks up a step's shift and level. Rebuilt on the message
+    thread whenever the settings change.
+
+    Swing and humanisation repeat every `length` steps. A template can be any
+    length, so it's kept in its own cycle and added in at lookup, rather than
+    folded into a table it may not divide into evenly.
+*/
+struct GrooveTable
+{
+    static constexpr int length = GrooveTemplate::maxLength;
+    static constexpr int maxChannels = 16;
+
+    // Shifts stay inside half a step, so a channel's hits can never swap order
+    static constexpr float maxShift = 0.49f;
+
+    std::array<std::array<float, length>, maxChannels> timing {}, velocity {};
+
+    // Already scaled by the template amount; templateLength is zero without one
+    int templateLength = 0;
+    std::array<float, GrooveTemplate::maxLength> templateTiming {}, templateVelocity {};
+
+    GrooveTable()
+    {
+        for (auto& v : velocity)
+            v.fill (1.0f);
+    }
+
+    float getTiming (int channel, juce::int64 step) const noexcept
+    {
+        auto shift = timing[(size_t) channel][(size_t) (step % length)];
+
+        if (templateLength > 0)
+            shift += templateTiming[(size_t) (step % templateLength)];
+
+        return juce::jlimit (-maxShift, maxShift, shift);
+    }
+
+    float getVelocity (int channel, juce::int64 step) const noexcept
+    {
+        auto level = velocity[(size_t) channel][(size_t) (step % length)];
+
+        if (templateLength > 0)
+            level *= templateVelocity[(size_t) (step % templateLength)];
+
+        return juce::jlimit (0.0f, 2.0f, level);
+    }
+
+    void build (const GrooveSettings& settings)
+    {
+        const auto swingShift = juce::jlimit (0.0f, 1.0f, settings.swing / 50.0f - 1.0f);
+        const auto& groove = settings.groove;
+
+        templateLength = groove.length;
+
+        for (int s = 0; s < templateLength; ++s)
+        {
+            templateTiming[(size_t) s] = groove.timing[(size_t) s] * settings.templateAmount;
+            templateVelocity[(size_t) s] = juce::jmap (settings.templateAmount, 1.0f, groove.velocity[(size_t) s]);
+        }
+
+        for (int c = 0; c < maxChannels; ++c)
+        {
+            // Each channel gets its own series from the one seed, so they drift apart but always the same way
+            juce::Random random ((juce::int64) settings.seed * 7919 + c);
+
+            for (int s = 0; s < length; ++s)
+            {
+                auto shift = (s % 2 == 1) ? swingShift : 0.0f;
+                auto level = 1.0f;
+
+                shift += (random.nextFloat() * 2.0f - 1.0f) * settings.timingHumanise;
+                level *= 1.0f + (random.nextFloat() * 2.0f - 1.0f) * settings.velocityHumanise;
+
+                timing[(size_t) c][(size_t) s] = juce::jlimit (-maxShift, maxShift, shift);
+                velocity[(size_t) c][(size_t) s] = juce::jlimit (0.0f, 2.0f, level);
+            }
+        }
+    }
+};
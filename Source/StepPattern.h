@@ -0,0 +1,326 @@
+/*
+  ==============================================================================
+
+    StepPattern.h
+    Created: 19 Oct 2026 5:02:41pm
+    Author:  Samuel Chadri
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "StepGroove.h"
+#include "StepGenerators.h"
+
+//==============================================================================
+/*
+    Flat copy of one of a StepClip's patterns, one bit per cell, plus the trig
+    settings of the cells that have any, the channel generators, what the player
+    needs to place the steps in the Edit and the groove to play them with. It's a
+    fixed-size value type so it can be copied and read by the audio thread
+    without touching the heap.
+
+    Every cell toggle copies the whole snapshot, so the trigs are kept as a short
+    sorted list of the cells that differ from the default rather than a slot for
+    every cell.
+*/
+struct StepPatternSnapshot
+{
+    static constexpr int maxChannels = 16;
+    static constexpr int maxSteps = 2048;   // 99 bars of 16ths fits comfortably
+    static constexpr int wordsPerChannel = maxSteps / 64;
+    static constexpr int maxTrigs = 1024;   // Cells with non-default trigs, across all channels
+
+    struct Channel
+    {
+        int noteNumber = 60;
+        int velocity = 96;
+        int midiChannel = 1;
+        StepGenerators::Euclid euclid;
+    };
+
+    struct Layout
+    {
+        int numChannels = 0, numSteps = 0;
+        int patternIndex = 0;   // Which of the clip's patterns this is
+        juce::uint32 seed = 1;
+        double stepLengthBeats = 0.25;
+        double clipStartBeat = 0.0, clipLengthBeats = 0.0, clipOffsetBeats = 0.0;
+        std::array<Channel, maxChannels> channels;
+    };
+
+    //==============================================================================
+    bool getStep (int channel, int step) const noexcept
+    {
+        if (! (juce::isPositiveAndBelow (channel, layout.numChannels) && juce::isPositiveAndBelow (step, layout.numSteps)))
+            return false;
+
+        return (bits[(size_t) channel][(size_t) (step >> 6)] & (juce::uint64 (1) << (step & 63))) != 0;
+    }
+
+    void setStep (int channel, int step, bool on) noexcept
+    {
+        if (! (juce::isPositiveAndBelow (channel, layout.numChannels) && juce::isPositiveAndBelow (step, layout.numSteps)))
+            return;
+
+        auto& word = bits[(size_t) channel][(size_t) (step >> 6)];
+        const auto bit = juce::uint64 (1) << (step & 63);
+        word = on ? (word | bit) : (word & ~bit);
+    }
+
+    /** True if the channel plays this step, either drawn or from its Euclidean generator. */
+    bool hasHit (int channel, int step) const noexcept
+    {
+        if (! juce::isPositiveAndBelow (channel, layout.numChannels))
+            return false;
+
+        const auto& euclid = layout.channels[(size_t) channel].euclid;
+        return euclid.isActive() ? euclid.isHit (step) : getStep (channel, step);
+    }
+
+    StepGenerators::StepTrig getTrig (int channel, int step) const noexcept
+    {
+        return StepGenerators::StepTrig::unpack (getPackedTrig (channel, step));
+    }
+
+    /** Returns false if the cell needed an entry and the list was already full. */
+    bool setTrig (int channel, int step, StepGenerators::StepTrig trig) noexcept
+    {
+        return setPackedTrig (channel, step, trig.pack());
+    }
+
+    juce::uint16 getPackedTrig (int channel, int step) const noexcept
+    {
+        if (! (juce::isPositiveAndBelow (channel, maxChannels) && juce::isPositiveAndBelow (step, maxSteps)))
+            return StepGenerators::StepTrig::defaultPacked;
+
+        const auto key = getTrigKey (channel, step);
+        const auto end = trigs.data() + numTrigs;
+        const auto i = findTrig (key);
+
+        return i != end && i->key == key ? i->packed : StepGenerators::StepTrig::defaultPacked;
+    }
+
+    bool setPackedTrig (int channel, int step, juce::uint16 packed) noexcept
+    {
+        if (! (juce::isPositiveAndBelow (channel, maxChannels) && juce::isPositiveAndBelow (step, maxSteps)))
+            return false;
+
+        const auto key = getTrigKey (channel, step);
+        const auto end = trigs.data() + numTrigs;
+        const auto i = trigs.data() + (findTrig (key) - trigs.data());
+        const bool exists = i != end && i->key == key;
+
+        if (packed == StepGenerators::StepTrig::defaultPacked)
+        {
+            if (exists)
+            {
+                std::move (i + 1, end, i);
+                --numTrigs;
+            }
+
+            return true;
+        }
+
+        if (exists)
+        {
+            i->packed = packed;
+            return true;
+        }
+
+        if (numTrigs >= maxTrigs)
+            return false;
+
+        std::move_backward (i, end, end + 1);
+        *i = { key, packed };
+        ++numTrigs;
+        return true;
+    }
+
+    /** Everything the player needs about one step, gathered in a single read. */
+    struct StepInfo
+    {
+        juce::uint32 mask = 0;      // One bit per channel that has a hit
+        std::array<float, maxChannels> shift {}, level {};
+        std::array<juce::uint16, maxChannels> trigs {};
+    };
+
+    StepInfo getStepInfo (int step) const noexcept
+    {
+        StepInfo info;
+
+        for (int i = 0; i < layout.numChannels; ++i)
+        {
+            if (hasHit (i, step))
+                info.mask |= 1u << i;
+
+            info.shift[(size_t) i] = groove.getTiming (i, step);
+            info.level[(size_t) i] = groove.getVelocity (i, step);
+            info.trigs[(size_t) i] = getPackedTrig (i, step);
+        }
+
+        return info;
+    }
+
+    juce::BigInteger getChannelBits (int channel) const
+    {
+        juce::BigInteger b;
+
+        for (int i = 0; i < layout.numSteps; ++i)
+            if (getStep (channel, i))
+                b.setBit (i);
+
+        return b;
+    }
+
+    /** Message thread. Copies one of the clip's patterns and the clip's position from the ValueTree. */
+    void loadFrom (tracktion_engine::StepClip& clip, int patternIndex = 0)
+    {
+        auto pattern = clip.getPattern (patternIndex);
+        auto clipChannels = clip.getChannels();
+        jassert (clipChannels.size() <= maxChannels);
+
+        layout.patternIndex = patternIndex;
+        layout.numChannels = juce::jmin (maxChannels, clipChannels.size());
+        layout.numSteps = juce::jlimit (0, maxSteps, pattern.getNumNotes());
+        layout.stepLengthBeats = juce::jmax (1.0e-3, pattern.getNoteLength());
+        layout.clipStartBeat = clip.getStartBeat();
+        layout.clipLengthBeats = clip.getLengthInBeats();
+        layout.clipOffsetBeats = clip.getOffsetInBeats();
+
+        for (auto& channelBits : bits)
+            channelBits.fill (0);
+
+        numTrigs = 0;
+
+        for (int i = 0; i < layout.numChannels; ++i)
+        {
+            auto c = clipChannels.getUnchecked (i);
+            layout.channels[(size_t) i] = { c->noteNumber.get(), c->noteValue.get(), c->channel.get().getChannelNumber(),
+                                            StepGenerators::Euclid::fromValueTree (c->state) };
+
+            const auto cells = pattern.getChannel (i);
+
+            for (int step = cells.findNextSetBit (0); juce::isPositiveAndBelow (step, layout.numSteps); step = cells.findNextSetBit (step + 1))
+                setStep (i, step, true);
+
+            // Only cells that differ from the default are stored, as "step:packed" pairs
+            auto channelState = pattern.state.getChild (i);
+
+            for (auto& token : juce::StringArray::fromTokens (channelState.getProperty (trigsID).toString(), " ", {}))
+            {
+                const auto step = token.upToFirstOccurrenceOf (":", false, false).getIntValue();
+
+                setPackedTrig (i, step, (juce::uint16) token.fromFirstOccurrenceOf (":", false, false).getIntValue());
+            }
+        }
+    }
+
+    /** The channel's cell trigs in the form loadFrom() reads back. */
+    juce::String getTrigsString (int channel) const
+    {
+        juce::StringArray tokens;
+
+        if (! juce::isPositiveAndBelow (channel, maxChannels))
+            return {};
+
+        const auto end = trigs.data() + numTrigs;
+
+        for (auto i = findTrig (getTrigKey (channel, 0)); i != end && i->key < getTrigKey (channel + 1, 0); ++i)
+            if (const auto step = (int) (i->key - getTrigKey (channel, 0)); step < layout.numSteps)
+                tokens.add (juce::String (step) + ":" + juce::String (i->packed));
+
+        return tokens.joinIntoString (" ");
+    }
+
+    static inline const juce::Identifier trigsID { "trigs" };
+
+    struct TrigEntry
+    {
+        juce::uint32 key = 0;   // See getTrigKey()
+        juce::uint16 packed = StepGenerators::StepTrig::defaultPacked;
+    };
+
+    Layout layout;
+    std::array<std::array<juce::uint64, wordsPerChannel>, maxChannels> bits {};
+    std::array<TrigEntry, maxTrigs> trigs {};
+    int numTrigs = 0;
+    GrooveTable groove;
+
+    // Sorted by channel, then step
+    static juce::uint32 getTrigKey (int channel, int step) noexcept    { return (juce::uint32) (channel * maxSteps + step); }
+
+    const TrigEntry* findTrig (juce::uint32 key) const noexcept
+    {
+        return std::lower_bound (trigs.data(), trigs.data() + numTrigs, key,
+                                 [] (const TrigEntry& e, juce::uint32 k) { return e.key < k; });
+    }
+
+    static_assert (GrooveTable::maxChannels == maxChannels, "The groove needs a row for every channel");
+};
+
+//==============================================================================
+/*
+    Double-buffered StepPatternSnapshot with a single writer (the message
+    thread) and any number of real-time readers. Edits are made to a copy of
+    the live snapshot, which is then published with an atomic flip. Readers
+    check a version number and retry in the rare case an edit landed mid-read,
+    so a toggle during playback is picked up on the next step.
+*/
+class StepPatternBuffer
+{
+public:
+    StepPatternBuffer() = default;
+
+    /** Writer thread only. The snapshot passed to the function becomes the live one once it returns. */
+    template <typename Function>
+    void update (Function&& f)
+    {
+        const auto live = active.load (std::memory_order_relaxed);
+        auto& next = snapshots[1 - live];
+
+        // Bumped before writing too, so a reader that was still on this copy always retries
+        version.fetch_add (1, std::memory_order_acq_rel);
+        next = snapshots[live];
+        f (next);
+
+        active.store (1 - live, std::memory_order_release);
+        version.fetch_add (1, std::memory_order_release);
+
+        if (onUpdate)
+            onUpdate();
+    }
+
+    /** Called on the writer thread after every update, once the new snapshot is live. */
+    std::function<void()> onUpdate;
+
+    /** Writer thread only. Nothing else writes, so no retry is needed. */
+    const StepPatternSnapshot& getLatest() const noexcept
+    {
+        return snapshots[active.load (std::memory_order_relaxed)];
+    }
+
+    /** Any thread. Keep the function short, it may be run more than once. */
+    template <typename Function>
+    auto read (Function&& f) const noexcept
+    {
+        for (;;)
+        {
+            const auto before = version.load (std::memory_order_acquire);
+            const auto result = f (snapshots[active.load (std::memory_order_acquire)]);
+            std::atomic_thread_fence (std::memory_order_acquire);
+
+            if (version.load (std::memory_order_relaxed) == before)
+                return result;
+        }
+    }
+
+private:
+    StepPatternSnapshot snapshots[2];
+    std::atomic<int> active { 0 };
+    std::atomic<juce::uint32> version { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (StepPatternBuffer)
+};
@@ -0,0 +1,573 @@
+/*
+  ==============================================================================
+
+    StepPlayerPlugin.h
+    Created: 19 Oct 2026 5:18:09pm
+    Author:  Samuel Chadri
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "StepPattern.h"
+#include "StepSong.h"
+#include "SamplePool.h"
+#include "RealtimeSanitizer.h"
+#include "RealtimeTempo.h"
+#include "../includes/common/TempoMapIndex.h"
+
+//==============================================================================
+/*
+    Plays the step sequencer track straight from a StepPatternBuffer. Each
+    channel is a one-shot voice over a sample borrowed from the SamplePool,
+    triggered on the exact sample its step falls on after the groove has
+    shifted it. It replaces both the MIDI tracktion generates from the
+    StepClip and the sampler that used to play it. Grid edits are published
+    to the buffer as they happen, so they are heard on the next step with no
+    MIDI regeneration or graph rebuild. With a song set it walks the song's
+    compiled timeline instead of looping one pattern.
+
+    Steps are placed through its own TempoMapIndex, except while a tempo drag
+    is live: then it counts beats from where it was at the live tempo, ramped
+    per sample like the metronome's, until the Edit's map has the new tempo.
+*/
+class StepPlayerPlugin : public tracktion_engine::Plugin
+{
+public:
+    StepPlayerPlugin (tracktion_engine::PluginCreationInfo info)
+        : Plugin (info),
+          tempoMap (edit.tempoSequence)
+    {
+        for (auto& s : liveSamples)
+            s.store (nullptr, std::memory_order_relaxed);
+
+        setGroove (GrooveSettings::fromValueTree (state.getChildWithName (GrooveSettings::grooveID)));
+        setGeneratorSeed (getGeneratorSeed());
+        song = StepSong::fromValueTree (state.getChildWithName (StepSong::songID));
+
+        // Grid edits reach the buffer before the clip, so the song is recompiled
+        // from the buffer or song mode wouldn't hear them until a commit
+        songRecompiler.setFunction ([this] { recompileSong(); });
+        pattern.onUpdate = [this] { if (! song.isEmpty()) songRecompiler.triggerAsyncUpdate(); };
+    }
+
+    ~StepPlayerPlugin() override
+    {
+        pattern.onUpdate = nullptr;
+        songRecompiler.cancelPendingUpdate();
+        notifyListenersOfDeletion();
+    }
+
+    static inline const char* xmlTypeName = "StepPlayerPlugin";
+    static inline const juce::Identifier generatorSeedID { "generatorSeed" };
+
+    //==============================================================================
+    juce::String getName() override                         { return NEEDS_TRANS("Step Player"); }
+    juce::String getPluginType() override                   { return xmlTypeName; }
+    juce::String getSelectableDescription() override        { return getName(); }
+    bool needsConstantBufferSize() override                 { return false; }
+    bool takesMidiInput() override                          { return true; }
+    bool isSynth() override                                 { return true; }
+    bool producesAudioWhenNoAudioInput() override           { return true; }
+    int getNumOutputChannelsGivenInputs (int) override      { return 2; }
+
+    void initialise (const tracktion_engine::PluginInitialisationInfo& info) override
+    {
+        sampleRate = info.sampleRate;
+        fadeLengthSamples = juce::jmax (1, juce::roundToInt (sampleRate * 0.005));
+        tempoFollower.prepare (sampleRate, liveTempo->getTargetBpm());
+        followingLiveTempo = false;
+
+        for (auto& v : voices)
+            v = {};
+    }
+
+    void deinitialise() override {}
+
+    void applyToBuffer (const tracktion_engine::PluginRenderContext& fc) override
+    {
+        const RealtimeSanitizer::ScopedRealtimeSection realtimeSection;
+        renderCount.fetch_add (1);
+        tempoFollower.update (*liveTempo);
+
+        if (fc.bufferForMidiMessages != nullptr)
+        {
+            auto& midi = *fc.bufferForMidiMessages;
+
+            // The clip's own MIDI would double every hit, so only the all-notes-off is acted on
+            if (midi.isAllNotesOff)
+                fadeOutAllVoices();
+
+            midi.clear();
+        }
+
+        if (fc.destBuffer == nullptr)
+        {
+            tempoFollower.advance (fc.bufferNumSamples);
+            return;
+        }
+
+        // Each channel is rendered up to its next hit, so hits shifted by different
+        // amounts on different channels all land on their own sample
+        Block block { *fc.destBuffer, fc.bufferStartSample, fc.bufferNumSamples };
+
+        const auto layout = pattern.read ([] (const StepPatternSnapshot& s) { return s.layout; });
+        const auto song = liveSongTimeline.load (std::memory_order_acquire);
+
+        if (! fc.isPlaying)
+            wasPlaying = false;
+
+        if (fc.isPlaying && layout.numSteps > 0 && layout.numChannels > 0)
+        {
+            block.blockStart = fc.editTime.getStart();
+            block.stepLengthBeats = layout.stepLengthBeats;
+            block.clipStartBeat = layout.clipStartBeat;
+            block.followingLiveTempo = updateLiveTempo (block.blockStart);
+
+            if (block.followingLiveTempo)
+            {
+                block.startBeat = liveBeat - layout.clipStartBeat;
+                block.endBeat = block.startBeat + tempoFollower.getBeatsOver (block.numSamples);
+            }
+            else
+            {
+                block.startBeat = tempoMap.timeToBeats (block.blockStart) - layout.clipStartBeat;
+                block.endBeat = tempoMap.timeToBeats (fc.editTime.getEnd()) - layout.clipStartBeat;
+            }
+
+            liveBeat = block.endBeat + layout.clipStartBeat;
+            lastBlockEnd = fc.editTime.getEnd();
+
+            block.numClipSteps = (juce::int64) std::ceil (layout.clipLengthBeats / block.stepLengthBeats - 1.0e-6);
+            block.offsetSteps = (juce::int64) std::floor (layout.clipOffsetBeats / block.stepLengthBeats + 1.0e-6);
+
+            // Widened by the largest groove shift either way, then each hit is checked against the block
+            block.firstStep = juce::jmax ((juce::int64) 0, (juce::int64) std::floor (block.startBeat / block.stepLengthBeats - GrooveTable::maxShift));
+            block.lastStep = juce::jmin (block.numClipSteps, (juce::int64) std::ceil (block.endBeat / block.stepLengthBeats + GrooveTable::maxShift));
+
+            for (int i = 0; i < layout.numChannels; ++i)
+                block.channelGains[(size_t) i] = juce::jlimit (0, 127, layout.channels[(size_t) i].velocity) / 127.0f;
+
+            // Passes are counted from the start of playback, and every jump back (a loop
+            // wrapping round) starts a new one, so each loop of the clip can differ
+            if (! wasPlaying)
+                loopCount = 0;
+            else if (block.startBeat < lastEndBeat - 1.0e-6)
+                ++loopCount;
+
+            wasPlaying = true;
+            lastEndBeat = block.endBeat;
+
+            if (song != nullptr)
+                playSong (block, *song, layout.seed);
+            else
+                playPattern (block, layout);
+        }
+
+        for (int i = 0; i < StepPatternSnapshot::maxChannels; ++i)
+            renderVoice (i, block.dest, block.bufferStartSample + block.numRendered[(size_t) i], block.numSamples - block.numRendered[(size_t) i]);
+
+        tempoFollower.advance (fc.bufferNumSamples);
+    }
+
+    //==============================================================================
+    /** The pattern the audio thread plays. Only the message thread may update it. */
+    StepPatternBuffer& getPattern() noexcept            { return pattern; }
+
+    /** Message thread. Republishes one of the clip's patterns and its position, and
+        recompiles the song if there is one since the pattern may be part of it.
+    */
+    void loadFromClip (tracktion_engine::StepClip& clip, int patternIndex = 0)
+    {
+        pattern.update ([&clip, patternIndex] (StepPatternSnapshot& s) { s.loadFrom (clip, patternIndex); });
+        compileSong (clip);
+    }
+
+    /** Message thread. Sets the sound a channel plays, nullptr to silence it. */
+    void setChannelSample (int channel, SamplePool::Sample::Ptr sample)
+    {
+        if (! juce::isPositiveAndBelow (channel, StepPatternSnapshot::maxChannels))
+            return;
+
+        releaseRetired();
+
+        auto& slot = channelSamples[(size_t) channel];
+
+        if (slot == sample)
+            return;
+
+        liveSamples[(size_t) channel].store (sample.get());
+
+        if (slot != nullptr)
+            retiredSamples.push_back ({ slot, renderCount.load() });
+
+        slot = sample;
+    }
+
+    SamplePool::Sample::Ptr getChannelSample (int channel) const
+    {
+        if (! juce::isPositiveAndBelow (channel, StepPatternSnapshot::maxChannels))
+            return {};
+
+        return channelSamples[(size_t) channel];
+    }
+
+    /** Message thread. Saves the groove in the plugin's state and publishes its table. */
+    void setGroove (const GrooveSettings& newSettings)
+    {
+        grooveSettings = newSettings;
+
+        auto newState = grooveSettings.toValueTree();
+        auto existing = state.getChildWithName (GrooveSettings::grooveID);
+
+        if (existing.isValid())
+            existing.copyPropertiesFrom (newState, nullptr);
+        else
+            state.addChild (newState, -1, nullptr);
+
+        pattern.update ([this] (StepPatternSnapshot& s) { s.groove.build (grooveSettings); });
+    }
+
+    const GrooveSettings& getGroove() const noexcept    { return grooveSettings; }
+
+    /** Message thread. Every probability roll is derived from this seed, so the
+        same seed always gives the same sequence of passes.
+    */
+    void setGeneratorSeed (juce::uint32 newSeed)
+    {
+        state.setProperty (generatorSeedID, (int) newSeed, nullptr);
+        pattern.update ([newSeed] (StepPatternSnapshot& s) { s.layout.seed = newSeed; });
+    }
+
+    juce::uint32 getGeneratorSeed() const
+    {
+        return (juce::uint32) (int) state.getProperty (generatorSeedID, 1);
+    }
+
+    /** Message thread. Saves the song in the plugin's state and publishes it compiled.
+        With an empty song the pattern last loaded is looped instead.
+    */
+    void setSong (const StepSong& newSong, tracktion_engine::StepClip& clip)
+    {
+        song = newSong;
+
+        auto existing = state.getChildWithName (StepSong::songID);
+
+        if (existing.isValid())
+            existing.copyPropertiesFrom (song.toValueTree(), nullptr);
+        else
+            state.addChild (song.toValueTree(), -1, nullptr);
+
+        compileSong (clip);
+    }
+
+    const StepSong& getSong() const noexcept            { return song; }
+
+private:
+    StepPatternBuffer pattern;
+    TempoMapIndex tempoMap;
+    juce::SharedResourcePointer<SamplePool> samplePool;
+    GrooveSettings grooveSettings;
+    StepSong song;
+    tracktion_engine::Selectable::WeakRef songClip;
+    tracktion_engine::AsyncCaller songRecompiler;
+
+    // The message thread owns the samples and the song; the audio thread only sees
+    // raw pointers. Anything replaced is kept until a later block has started, so
+    // it's never freed while the audio thread might still be reading it.
+    struct RetiredSample
+    {
+        SamplePool::Sample::Ptr sample;
+        juce::uint32 renderCountWhenRetired = 0;
+    };
+
+    struct RetiredTimeline
+    {
+        std::unique_ptr<StepSongTimeline> timeline;
+        juce::uint32 renderCountWhenRetired = 0;
+    };
+
+    std::array<SamplePool::Sample::Ptr, StepPatternSnapshot::maxChannels> channelSamples;
+    std::array<std::atomic<SamplePool::Sample*>, StepPatternSnapshot::maxChannels> liveSamples {};
+    std::vector<RetiredSample> retiredSamples;
+    std::unique_ptr<StepSongTimeline> songTimeline;
+    std::atomic<const StepSongTimeline*> liveSongTimeline { nullptr };
+    std::vector<RetiredTimeline> retiredTimelines;
+    std::atomic<juce::uint32> renderCount { 0 };
+
+    void releaseRetired()
+    {
+        // The block that was running when something was swapped has finished once the
+        // count has moved on; waiting for two leaves room for a block just starting
+        const auto count = renderCount.load();
+        const auto sizeBefore = retiredSamples.size();
+
+        retiredSamples.erase (std::remove_if (retiredSamples.begin(), retiredSamples.end(),
+                                              [count] (const RetiredSample& r) { return count - r.renderCountWhenRetired >= 2; }),
+                              retiredSamples.end());
+
+        retiredTimelines.erase (std::remove_if (retiredTimelines.begin(), retiredTimelines.end(),
+                                                [count] (const RetiredTimeline& r) { return count - r.renderCountWhenRetired >= 2; }),
+                                retiredTimelines.end());
+
+        if (retiredSamples.size() != sizeBefore)
+            samplePool->purgeUnused();
+    }
+
+    void compileSong (tracktion_engine::StepClip& clip)
+    {
+        releaseRetired();
+        songClip = &clip;
+        songRecompiler.cancelPendingUpdate();
+
+        auto newTimeline = song.isEmpty() ? nullptr : StepSongTimeline::compile (song, clip, &pattern.getLatest());
+        liveSongTimeline.store (newTimeline.get());
+
+        if (songTimeline != nullptr)
+            retiredTimelines.push_back ({ std::move (songTimeline), renderCount.load() });
+
+        songTimeline = std::move (newTimeline);
+    }
+
+    void recompileSong()
+    {
+        if (auto clip = dynamic_cast<tracktion_engine::StepClip*> (songClip.get()))
+            compileSong (*clip);
+    }
+
+    //==============================================================================
+    // Audio thread state, one voice per channel so a new hit chokes the last one
+    struct Voice
+    {
+        bool active = false;
+        double position = 0.0;
+        float gain = 0.0f;
+        int fadeSamplesLeft = -1;
+    };
+
+    std::array<Voice, StepPatternSnapshot::maxChannels> voices;
+    bool wasPlaying = false;
+    juce::int64 loopCount = 0;
+    double lastEndBeat = 0.0;
+    size_t songCursor = 0;
+    double sampleRate = 44100.0;
+    int fadeLengthSamples = 220;
+
+    // Audio thread. The beat the next block starts on while following a live tempo
+    juce::SharedResourcePointer<RealtimeTempo> liveTempo;
+    RealtimeTempo::Follower tempoFollower;
+    bool followingLiveTempo = false;
+    juce::uint32 mapVersionWhenLive = 0;
+    double liveBeat = 0.0, lastBlockEnd = 0.0;
+
+    // Starts following the live tempo from wherever the map has got to, and hands back
+    // once the map has been committed: it's been rebuilt, or already has the tempo.
+    // A jump in the Edit's time (a loop or a seek) starts counting again from the map.
+    bool updateLiveTempo (double blockStart) noexcept
+    {
+        const auto jumped = ! wasPlaying || std::abs (blockStart - lastBlockEnd) > 1.0 / sampleRate;
+
+        if (liveTempo->isLive())
+        {
+            if (! followingLiveTempo)
+            {
+                followingLiveTempo = true;
+                mapVersionWhenLive = tempoMap.getVersion();
+                liveBeat = tempoMap.timeToBeats (blockStart);
+            }
+        }
+        else if (followingLiveTempo
+                 && (tempoMap.getVersion() != mapVersionWhenLive
+                      || std::abs (tempoMap.getBpmAt (liveBeat) - liveTempo->getTargetBpm()) < 1.0e-3))
+        {
+            followingLiveTempo = false;
+        }
+
+        if (followingLiveTempo && jumped)
+            liveBeat = tempoMap.timeToBeats (blockStart);
+
+        return followingLiveTempo;
+    }
+
+    // Where the block being rendered falls in the clip, and how far each channel has got
+    struct Block
+    {
+        juce::AudioBuffer<float>& dest;
+        int bufferStartSample = 0, numSamples = 0;
+        double blockStart = 0.0, startBeat = 0.0, endBeat = 0.0;
+        double clipStartBeat = 0.0, stepLengthBeats = 0.25;
+        bool followingLiveTempo = false;
+        juce::int64 numClipSteps = 0, offsetSteps = 0, firstStep = 0, lastStep = 0;
+        std::array<float, StepPatternSnapshot::maxChannels> channelGains {};
+        std::array<int, StepPatternSnapshot::maxChannels> numRendered {};
+    };
+
+    void playPattern (Block& block, const StepPatternSnapshot::Layout& layout) noexcept
+    {
+        const auto passesPerLoop = juce::jmax ((juce::int64) 1, (block.numClipSteps + block.offsetSteps + layout.numSteps - 1) / layout.numSteps);
+
+        for (auto step = block.firstStep; step < block.lastStep; ++step)
+        {
+            const auto patternStep = (int) ((step + block.offsetSteps) % layout.numSteps);
+            const auto info = pattern.read ([patternStep] (const StepPatternSnapshot& s) { return s.getStepInfo (patternStep); });
+
+            if (info.mask == 0)
+                continue;
+
+            const auto pass = loopCount * passesPerLoop + (step + block.offsetSteps) / layout.numSteps;
+
+            for (int i = 0; i < layout.numChannels; ++i)
+            {
+                if ((info.mask & (1u << i)) == 0)
+                    continue;
+
+                const auto trig = StepGenerators::StepTrig::unpack (info.trigs[(size_t) i]);
+
+                if (StepGenerators::shouldPlay (trig, layout.seed, pass, i, patternStep))
+                    playHit (block, i, step, info.shift[(size_t) i], trig,
+                             block.channelGains[(size_t) i] * info.level[(size_t) i]);
+            }
+        }
+    }
+
+    void playSong (Block& block, const StepSongTimeline& song, juce::uint32 seed) noexcept
+    {
+        if (song.numSteps <= 0)
+            return;
+
+        const auto songLoopsPerClip = (block.numClipSteps + block.offsetSteps + song.numSteps - 1) / song.numSteps;
+        auto step = block.firstStep;
+
+        // The block's steps are walked in runs that don't cross the end of the song
+        while (step < block.lastStep)
+        {
+            const auto songLoop = (step + block.offsetSteps) / song.numSteps;
+            const auto runStart = (step + block.offsetSteps) % song.numSteps;
+            const auto runEnd = juce::jmin (song.numSteps, runStart + (block.lastStep - step));
+
+            for (songCursor = song.seek (runStart, songCursor); songCursor < song.events.size(); ++songCursor)
+            {
+                const auto& e = song.events[songCursor];
+
+                if (e.step >= runEnd)
+                    break;
+
+                const auto trig = StepGenerators::StepTrig::unpack (e.trig);
+                const auto pass = (loopCount * songLoopsPerClip + songLoop) * song.passesPerSong[e.pattern] + e.pass;
+
+                if (StepGenerators::shouldPlay (trig, seed, pass, e.channel, e.step))
+                {
+                    const auto info = pattern.read ([&e] (const StepPatternSnapshot& s)
+                                                    {
+                                                        return std::make_pair (s.groove.getTiming (e.channel, e.step),
+                                                                               s.groove.getVelocity (e.channel, e.step));
+                                                    });
+
+                    playHit (block, e.channel, step + e.step - runStart, info.first, trig,
+                             block.channelGains[e.channel] * info.second);
+                }
+            }
+
+            step += runEnd - runStart;
+        }
+    }
+
+    void playHit (Block& block, int channel, juce::int64 step, float shift, StepGenerators::StepTrig trig, float gain) noexcept
+    {
+        // Ratchets are spread over the part of the step the next step's shift can't reach
+        const auto ratchetSpacing = (1.0 - GrooveTable::maxShift - shift) / trig.ratchets;
+
+        for (int r = 0; r < trig.ratchets; ++r)
+        {
+            const auto hitBeat = (step + shift + r * ratchetSpacing) * block.stepLengthBeats;
+
+            if (hitBeat < block.startBeat || hitBeat >= block.endBeat || hitBeat < 0.0)
+                continue;
+
+            const auto offset = juce::jlimit (0, block.numSamples - 1, hitOffset (block, hitBeat));
+            auto& rendered = block.numRendered[(size_t) channel];
+
+            renderVoice (channel, block.dest, block.bufferStartSample + rendered, offset - rendered);
+            rendered = juce::jmax (rendered, offset);
+
+            startVoice (channel, juce::jlimit (0.0f, 1.0f, gain));
+        }
+    }
+
+    int hitOffset (const Block& block, double hitBeat) noexcept
+    {
+        if (block.followingLiveTempo)
+            return tempoFollower.getSampleForBeats (hitBeat - block.startBeat, block.numSamples);
+
+        const auto hitTime = tempoMap.beatsToTime (block.clipStartBeat + hitBeat);
+        return juce::roundToInt ((hitTime - block.blockStart) * sampleRate);
+    }
+
+    void startVoice (int channel, float gain) noexcept
+    {
+        auto& v = voices[(size_t) channel];
+        v.active = true;
+        v.position = 0.0;
+        v.gain = gain;
+        v.fadeSamplesLeft = -1;
+    }
+
+    void fadeOutAllVoices() noexcept
+    {
+        for (auto& v : voices)
+            if (v.active && v.fadeSamplesLeft < 0)
+                v.fadeSamplesLeft = fadeLengthSamples;
+    }
+
+    void renderVoice (int channel, juce::AudioBuffer<float>& dest, int startSample, int numSamples) noexcept
+    {
+        auto& v = voices[(size_t) channel];
+
+        if (numSamples <= 0 || ! v.active)
+            return;
+
+        auto sample = liveSamples[(size_t) channel].load (std::memory_order_acquire);
+
+        if (sample == nullptr)
+        {
+            v.active = false;
+            return;
+        }
+
+        const auto& source = sample->buffer;
+        const int length = source.getNumSamples();
+        const int numSourceChannels = source.getNumChannels();
+        const int numDestChannels = dest.getNumChannels();
+        const auto increment = sample->sampleRate / sampleRate;
+
+        for (int n = startSample; n < startSample + numSamples; ++n)
+        {
+            const auto index = (int) v.position;
+
+            if (index + 1 >= length || v.fadeSamplesLeft == 0)
+            {
+                v.active = false;
+                break;
+            }
+
+            const auto alpha = (float) (v.position - index);
+            auto gain = v.gain;
+
+            if (v.fadeSamplesLeft > 0)
+                gain *= (float) v.fadeSamplesLeft-- / (float) fadeLengthSamples;
+
+            for (int c = 0; c < numDestChannels; ++c)
+            {
+                const auto* src = source.getReadPointer (juce::jmin (c, numSourceChannels - 1));
+                const auto value = src[index] + alpha * (src[index + 1] - src[index]);
+                dest.addSample (c, n, value * gain);
+            }
+
+            v.position += increment;
+        }
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StepPlayerPlugin)
+};
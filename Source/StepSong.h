@@ -0,0 +1,224 @@
+/*
+  ==============================================================================
+
+    StepSong.h
+    Created: 19 Oct 2026 8:47:05pm
+    Author:  Samuel Chadri
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "StepPattern.h"
+
+//==============================================================================
+/*
+    A chain of the step clip's patterns, each played a number of times with
+    some of its channels muted. An empty song means the player just loops the
+    pattern being edited.
+
+    Written as text, one entry per word: the pattern letter, then "*n" to
+    repeat it and "-c" for each channel (counting from 1) to mute, so
+    "A*4 B*2-1-3 A" plays A four times, B twice without channels 1 and 3,
+    then A once more.
+*/
+struct StepSong
+{
+    static constexpr int maxPatterns = 26;
+
+    struct Entry
+    {
+        int pattern = 0;
+        int repeats = 1;
+        juce::uint32 muteMask = 0;  // One bit per channel
+    };
+
+    juce::Array<Entry> entries;
+
+    bool isEmpty() const noexcept       { return entries.isEmpty(); }
+
+    static juce::String getPatternName (int pattern)
+    {
+        return juce::String::charToString ((juce::juce_wchar) ('A' + juce::jlimit (0, maxPatterns - 1, pattern)));
+    }
+
+    juce::String toString() const
+    {
+        juce::StringArray words;
+
+        for (auto& e : entries)
+        {
+            auto word = getPatternName (e.pattern);
+
+            if (e.repeats > 1)
+                word << "*" << e.repeats;
+
+            for (int c = 0; c < StepPatternSnapshot::maxChannels; ++c)
+                if ((e.muteMask & (1u << c)) != 0)
+                    word << "-" << (c + 1);
+
+            words.add (word);
+        }
+
+        return words.joinIntoString (" ");
+    }
+
+    /** Anything that isn't a pattern letter is skipped, so a half-typed song still plays what it can. */
+    static StepSong fromString (const juce::String& s)
+    {
+        StepSong song;
+
+        for (auto& word : juce::StringArray::fromTokens (s.toUpperCase(), " ,", {}))
+        {
+            const auto letter = word[0];
+
+            if (letter < 'A' || letter >= 'A' + maxPatterns)
+                continue;
+
+            Entry e;
+            e.pattern = (int) (letter - 'A');
+
+            if (word.containsChar ('*'))
+                e.repeats = juce::jlimit (1, 999, word.fromFirstOccurrenceOf ("*", false, false).getIntValue());
+
+            auto mutes = juce::StringArray::fromTokens (word.fromFirstOccurrenceOf ("-", true, false), "-", {});
+
+            for (auto& m : mutes)
+                if (auto channel = m.getIntValue() - 1; juce::isPositiveAndBelow (channel, StepPatternSnapshot::maxChannels))
+                    e.muteMask |= 1u << channel;
+
+            song.entries.add (e);
+        }
+
+        return song;
+    }
+
+    /** How long the song runs with the clip's patterns as they are now. */
+    double getLengthInBeats (tracktion_engine::StepClip& clip) const
+    {
+        const auto numPatterns = juce::jmin (maxPatterns, clip.getPatterns().size());
+        double length = 0.0;
+
+        for (auto& e : entries)
+        {
+            if (juce::isPositiveAndBelow (e.pattern, numPatterns))
+            {
+                auto pattern = clip.getPattern (e.pattern);
+                length += e.repeats * pattern.getNumNotes() * pattern.getNoteLength();
+            }
+        }
+
+        return length;
+    }
+
+    static inline const juce::Identifier songID { "SONG" };
+
+    juce::ValueTree toValueTree() const
+    {
+        return juce::ValueTree (songID, { { "chain", toString() } });
+    }
+
+    static StepSong fromValueTree (const juce::ValueTree& v)
+    {
+        return fromString (v.getProperty ("chain").toString());
+    }
+};
+
+//==============================================================================
+/*
+    A StepSong compiled down to every hit it plays, sorted by step, so playing
+    an arrangement is a walk along one array however it was put together.
+    Built on the message thread from the clip's patterns and never changed
+    once the player has it; an edit builds a whole new one.
+*/
+struct StepSongTimeline
+{
+    struct Event
+    {
+        juce::int32 step;       // From the start of the song
+        juce::int32 pass;       // How many times this pattern has already played in the song
+        juce::uint16 trig;
+        juce::uint8 channel, pattern;
+    };
+
+    std::vector<Event> events;
+    juce::int64 numSteps = 0;
+    std::array<int, StepSong::maxPatterns> passesPerSong {};
+
+    /** Message thread. Patterns the clip doesn't have are left out. The pattern in
+        `live`, if given, is taken from it rather than the clip, so edits that haven't
+        been committed to the clip yet are heard too.
+    */
+    static std::unique_ptr<StepSongTimeline> compile (const StepSong& song, tracktion_engine::StepClip& clip,
+                                                      const StepPatternSnapshot* live = nullptr)
+    {
+        auto timeline = std::make_unique<StepSongTimeline>();
+        const auto numPatterns = juce::jmin (StepSong::maxPatterns, clip.getPatterns().size());
+
+        // Each pattern is only flattened once, however often the song uses it
+        std::array<std::unique_ptr<StepPatternSnapshot>, StepSong::maxPatterns> patterns;
+
+        for (auto& e : song.entries)
+        {
+            if (! juce::isPositiveAndBelow (e.pattern, numPatterns))
+                continue;
+
+            auto& p = patterns[(size_t) e.pattern];
+
+            if (p == nullptr)
+            {
+                p = std::make_unique<StepPatternSnapshot>();
+
+                if (live != nullptr && live->layout.patternIndex == e.pattern)
+                    *p = *live;
+                else
+                    p->loadFrom (clip, e.pattern);
+            }
+
+            auto& passes = timeline->passesPerSong[(size_t) e.pattern];
+
+            for (int r = 0; r < e.repeats; ++r, ++passes)
+            {
+                for (int step = 0; step < p->layout.numSteps; ++step)
+                {
+                    for (int c = 0; c < p->layout.numChannels; ++c)
+                    {
+                        if ((e.muteMask & (1u << c)) != 0 || ! p->hasHit (c, step))
+                            continue;
+
+                        timeline->events.push_back ({ (juce::int32) (timeline->numSteps + step), passes,
+                                                      p->getPackedTrig (c, step), (juce::uint8) c, (juce::uint8) e.pattern });
+                    }
+                }
+
+                timeline->numSteps += p->layout.numSteps;
+            }
+        }
+
+        return timeline;
+    }
+
+    /** The index of the first event at or after a step. The last answer is passed
+        back in as a hint, since consecutive blocks almost always land next to it.
+    */
+    size_t seek (juce::int64 step, size_t hint) const noexcept
+    {
+        const auto size = events.size();
+        hint = juce::jmin (hint, size);
+
+        for (int i = 0; i < 16; ++i)
+        {
+            if (hint > 0 && events[hint - 1].step >= step)
+                --hint;
+            else if (hint < size && events[hint].step < step)
+                ++hint;
+            else
+                return hint;
+        }
+
+        return (size_t) (std::lower_bound (events.begin(), events.end(), step,
+                                           [] (const Event& e, juce::int64 s) { return e.step < s; }) - events.begin());
+    }
+};
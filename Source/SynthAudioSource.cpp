@@ -6,6 +6,7 @@
 //
 
 #include "SynthAudioSource.h"
+#include "RealtimeSanitizer.h"
 
 
 
@@ -310,9 +311,15 @@ juce::String SynthAudioSource::getSelectableDescription()
     return getName();
 }
 
-void SynthAudioSource::initialise(const tracktion_engine::PluginInitialisationInfo &)
+void SynthAudioSource::initialise(const tracktion_engine::PluginInitialisationInfo & info)
 {
+    renderSampleRate = info.sampleRate;
     
+    for(auto& fifo : directMidiFifos)
+        fifo.prepare(info.sampleRate, directMidi);
+    
+    // Room for both direct queues plus a busy block of track MIDI, so rendering never reallocates
+    renderMidi.ensureSize(32768);
 }
 
 
@@ -323,27 +330,43 @@ void SynthAudioSource::deinitialise()
 
 void SynthAudioSource::applyToBuffer(const tracktion_engine::PluginRenderContext &fc)
 {
-    juce::MidiBuffer midi;
+    // Graph worker threads don't go through MainComponent's callback, so mark them here too
+    const RealtimeSanitizer::ScopedRealtimeSection realtimeSection;
+    
+    if(fc.destBuffer == nullptr)
+        return;
+    
+    renderMidi.clear();
     
-    if(fc.destBuffer != nullptr)
+    if(fc.bufferForMidiMessages != nullptr)
     {
-        if(fc.bufferForMidiMessages != nullptr)
-        {
-            if(fc.bufferForMidiMessages->isAllNotesOff)
-                //turn of notes here maybe
-                DBG("SDF");
-        }
+        if(fc.bufferForMidiMessages->isAllNotesOff)
+            synth.allNotesOff(0, true);
         
-        for(auto m : *fc.bufferForMidiMessages)
+        // Track MIDI is timestamped in seconds from the start of this block
+        for(auto& m : *fc.bufferForMidiMessages)
         {
-            midi.addEvent(m, m.getTimeStamp());
+            const auto offset = juce::jlimit(0, fc.bufferNumSamples - 1, juce::roundToInt(m.getTimeStamp() * renderSampleRate));
+            renderMidi.addEvent(m, fc.bufferStartSample + offset);
         }
-        
-        synth.renderNextBlock(*fc.destBuffer, midi, fc.bufferStartSample, fc.bufferNumSamples);
-        
     }
     
+    // The direct queues are always drained so nothing stale is left behind when monitoring is toggled
+    directMidi.clear();
+    
+    for(auto& fifo : directMidiFifos)
+        fifo.drainInto(directMidi, fc.bufferNumSamples);
+    
+    const bool lowLatency = lowLatencyMonitoring.load(std::memory_order_relaxed);
+    
+    if(lowLatency)
+        renderMidi.addEvents(directMidi, 0, -1, fc.bufferStartSample);
+    else if(wasLowLatencyMonitoring)
+        synth.allNotesOff(0, true);
+    
+    wasLowLatencyMonitoring = lowLatency;
     
+    synth.renderNextBlock(*fc.destBuffer, renderMidi, fc.bufferStartSample, fc.bufferNumSamples);
 }
 
 void SynthAudioSource::restorePluginStateFromValueTree(const juce::ValueTree &v)
@@ -386,7 +409,7 @@ void SynthAudioSource::setSynthPreset(int synthPreset)
 void SynthAudioSource::prepareToPlay(int /*samplesPerBlockExpected*/, double sampleRate)
 {
     synth.setCurrentPlaybackSampleRate(sampleRate);
-    midiCollector.reset(sampleRate);
+    liveMidiFifo.prepare(sampleRate, liveMidi);
 }
 
 void SynthAudioSource::releaseResources() {}
@@ -412,10 +435,10 @@ void SynthAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& buf
 {
     bufferToFill.clearActiveBufferRegion();
     
-    juce::MidiBuffer incomingMidi;
-    midiCollector.removeNextBlockOfMessages(incomingMidi, bufferToFill.numSamples);
+    liveMidi.clear();
+    liveMidiFifo.drainInto(liveMidi, bufferToFill.numSamples);
     
-    keyboardState->processNextMidiBuffer(incomingMidi, bufferToFill.startSample, bufferToFill.numSamples, true);
+    keyboardState->processNextMidiBuffer(liveMidi, bufferToFill.startSample, bufferToFill.numSamples, true);
     
     
     /*
@@ -425,7 +448,25 @@ void SynthAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& buf
     */
 }
 
-juce::MidiMessageCollector* SynthAudioSource::getMidiCollector()
+MidiEventFifo& SynthAudioSource::getLiveMidiFifo()
 {
-    return &midiCollector;
+    return liveMidiFifo;
+}
+
+void SynthAudioSource::setLowLatencyMonitoring(bool shouldBeEnabled)
+{
+    lowLatencyMonitoring.store(shouldBeEnabled, std::memory_order_relaxed);
+}
+
+bool SynthAudioSource::isLowLatencyMonitoring() const
+{
+    return lowLatencyMonitoring.load(std::memory_order_relaxed);
+}
+
+bool SynthAudioSource::injectLiveMessage(LiveSource source, const juce::MidiMessage& message)
+{
+    if(! isLowLatencyMonitoring())
+        return false;
+    
+    return directMidiFifos[(int) source].push(message);
 }
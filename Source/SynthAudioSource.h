@@ -7,6 +7,7 @@
 
 #pragma once
 #include <JuceHeader.h>
+#include "MidiEventFifo.h"
 struct SynthPresetInfo
 {
     int identifier;
@@ -38,7 +39,30 @@ public:
     void prepareToPlay(int,double sampleRate) override;
     void releaseResources() override;
     void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
-    juce::MidiMessageCollector* getMidiCollector();
+    /** Live input from the MIDI device thread, drained in getNextAudioBlock(). */
+    MidiEventFifo& getLiveMidiFifo();
+    
+    //========================================================================
+    /** Where a directly injected event came from. Each source has its own queue
+        so every queue keeps a single producer thread.
+    */
+    enum class LiveSource
+    {
+        keyboard,   // message thread
+        device,     // MIDI device thread
+        numSources
+    };
+    
+    /** In low-latency monitoring mode live events skip the input device and track
+        routing and are rendered by applyToBuffer() in the very next callback.
+    */
+    void setLowLatencyMonitoring(bool shouldBeEnabled);
+    bool isLowLatencyMonitoring() const;
+    
+    /** Queues a live event for the next render. Does nothing unless low-latency
+        monitoring is on. Must only be called from the thread that owns the source.
+    */
+    bool injectLiveMessage(LiveSource source, const juce::MidiMessage& message);
     
     void setSynthPreset(int synthPreset);
     static juce::Array<SynthPresetInfo> getSynthList();
@@ -50,7 +74,14 @@ public:
 private:
     juce::MidiKeyboardState* keyboardState;
     juce::Synthesiser synth;
-    juce::MidiMessageCollector midiCollector;
+    MidiEventFifo liveMidiFifo;
+    juce::MidiBuffer liveMidi;
+    
+    MidiEventFifo directMidiFifos[(int) LiveSource::numSources];
+    juce::MidiBuffer renderMidi, directMidi;
+    std::atomic<bool> lowLatencyMonitoring {false};
+    bool wasLowLatencyMonitoring = false;
+    double renderSampleRate = 44100.0;
     static juce::Array<SynthPresetInfo> synthList;
     static bool sInit;
     static std::map<int,std::string> sList;
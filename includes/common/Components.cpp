@@ -252,6 +252,75 @@ te::Plugin::Ptr showMenuAndCreatePlugin (te::Edit& edit)
     return {};
 }
 
+//==============================================================================
+void BeatGridCache::draw (Graphics& g, EditViewState& evs, int width, int height)
+{
+    const auto visibleLength = evs.viewX2 - evs.viewX1;
+    
+    if (width <= 0 || height <= 0 || visibleLength <= 0.0)
+        return;
+    
+    const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    const Key newKey { visibleLength / width, width, height, scale, evs.tempoMap->getVersion() };
+    const auto imageEndTime = imageStartTime + screensPerImage * visibleLength;
+    
+    if (! image.isValid() || ! (newKey == key) || evs.viewX1 < imageStartTime || evs.viewX2 > imageEndTime)
+    {
+        key = newKey;
+        imageStartTime = evs.viewX1 - visibleLength;
+        render (evs);
+    }
+    
+    // Whole physical pixels, so the lines stay sharp
+    const auto x = roundToInt ((imageStartTime - evs.viewX1) / key.secondsPerPixel * scale) / scale;
+    g.drawImageTransformed (image, AffineTransform::scale (1.0f / scale).translated (x, 0.0f));
+}
+
+void BeatGridCache::render (EditViewState& evs)
+{
+    const auto width = key.width * screensPerImage;
+    image = Image (Image::ARGB, roundToInt (width * key.scale), roundToInt (key.height * key.scale), true);
+    
+    Graphics g (image);
+    g.addTransform (AffineTransform::scale (key.scale));
+    
+    const auto startTime = jmax (0.0, imageStartTime);
+    const auto endTime = imageStartTime + width * key.secondsPerPixel;
+    auto timeToX = [this] (double t) { return (float) ((t - imageStartTime) / key.secondsPerPixel); };
+    
+    // Beats, as long as they aren't too close together to be any use
+    const auto firstBeat = std::ceil (evs.timeToBeat (startTime));
+    const auto lastBeat = evs.timeToBeat (endTime);
+    
+    if ((lastBeat - firstBeat) * minPixelsPerBeat < width)
+    {
+        g.setColour (Colours::black.withAlpha (0.1f));
+        
+        for (auto beat = firstBeat; beat <= lastBeat; beat += 1.0)
+            g.fillRect (timeToX (evs.beatToTime (beat)), 0.0f, 1.0f, (float) key.height);
+    }
+    
+    // Bars, skipping any that would land on top of the last one drawn
+    g.setColour (Colours::black.withAlpha (0.25f));
+    auto lastX = -minPixelsPerBar;
+    
+    for (int bar = evs.edit.tempoSequence.timeToBarsBeats (startTime).bars, numDrawn = 0; numDrawn <= width; ++bar, ++numDrawn)
+    {
+        const auto t = evs.tempoMap->barsBeatsToTime ({ bar, 0.0 });
+        
+        if (t > endTime)
+            break;
+        
+        const auto x = timeToX (t);
+        
+        if (t >= startTime && x - lastX >= minPixelsPerBar)
+        {
+            g.fillRect (x, 0.0f, 1.0f, (float) key.height);
+            lastX = x;
+        }
+    }
+}
+
 //==============================================================================
 ClipComponent::ClipComponent (EditViewState& evs, te::Clip::Ptr c)
     : editViewState (evs), clip (c)
@@ -260,9 +329,40 @@ ClipComponent::ClipComponent (EditViewState& evs, te::Clip::Ptr c)
 
 void ClipComponent::paint (Graphics& g)
 {
-    g.fillAll (clip->getColour().withAlpha (0.5f));
-    g.setColour (Colours::black);
-    g.drawRect (getLocalBounds());
+    auto p = getParentComponent();
+    const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    
+    const auto visible = p != nullptr ? getLocalBounds().getIntersection (p->getLocalBounds() - getPosition())
+                                      : Rectangle<int>();
+    
+    if (visible.isEmpty())
+    {
+        staticLayer = {};
+        paintStaticLayer (g);
+    }
+    else
+    {
+        // Keyed on the zoom rather than the view's position, so scrolling keeps the image
+        const StaticLayerKey key { getWidth(), getHeight(), scale,
+                                   (editViewState.viewX2 - editViewState.viewX1) / p->getWidth(),
+                                   clip->getPosition().getStart(), clip->getColour().getARGB(),
+                                   editViewState.tempoMap->getVersion(), clip->getName() };
+        
+        if (! staticLayer.isValid() || ! (key == staticLayerKey) || ! staticLayerArea.contains (visible))
+        {
+            staticLayerArea = visible.expanded (cachedMargin, 0).getIntersection (getLocalBounds());
+            staticLayer = Image (Image::ARGB, roundToInt (staticLayerArea.getWidth() * scale),
+                                 roundToInt (staticLayerArea.getHeight() * scale), true);
+            staticLayerKey = key;
+            
+            Graphics lg (staticLayer);
+            lg.addTransform (AffineTransform::translation (-staticLayerArea.getPosition().toFloat()).scaled (scale));
+            paintStaticLayer (lg);
+        }
+        
+        g.drawImageTransformed (staticLayer, AffineTransform::scale (1.0f / scale)
+                                                .translated (staticLayerArea.getPosition().toFloat()));
+    }
     
     if (editViewState.selectionManager.isSelected (clip.get()))
     {
@@ -271,6 +371,25 @@ void ClipComponent::paint (Graphics& g)
     }
 }
 
+void ClipComponent::paintStaticLayer (Graphics& g)
+{
+    g.fillAll (clip->getColour().withAlpha (0.5f));
+    g.setColour (Colours::black);
+    g.drawRect (getLocalBounds());
+    
+    if (getWidth() > 30)
+    {
+        g.setFont (12.0f);
+        g.drawText (clip->getName(), getLocalBounds().reduced (4, 2).removeFromTop (14), Justification::centredLeft, true);
+    }
+}
+
+void ClipComponent::invalidateStaticLayer()
+{
+    staticLayer = {};
+    repaint();
+}
+
 void ClipComponent::mouseDown (const MouseEvent&)
 {
     editViewState.selectionManager.selectOnly (clip.get());
@@ -283,6 +402,12 @@ AudioClipComponent::AudioClipComponent (EditViewState& evs, te::Clip::Ptr c)
     updateThumbnail();
 }
 
+AudioClipComponent::~AudioClipComponent()
+{
+    if (peakPyramid != nullptr)
+        peakPyramid->removeChangeListener (this);
+}
+
 void AudioClipComponent::paint (Graphics& g)
 {
     ClipComponent::paint (g);
@@ -355,18 +480,24 @@ void AudioClipComponent::drawChannels (Graphics& g, te::SmartThumbnail& thumb, R
                                        te::EditTimeRange time, bool useLeft, bool useRight,
                                        float leftGain, float rightGain)
 {
+    auto drawChannel = [&] (Rectangle<int> channelArea, int channel, float gain)
+    {
+        if (peakPyramid == nullptr || ! peakPyramid->drawChannel (g, channelArea, { time.getStart(), time.getEnd() }, channel, gain))
+            thumb.drawChannel (g, channelArea, useHighRes, time, channel, gain);
+    };
+
     if (useLeft && useRight && thumb.getNumChannels() > 1)
     {
-        thumb.drawChannel (g, area.removeFromTop (area.getHeight() / 2), useHighRes, time, 0, leftGain);
-        thumb.drawChannel (g, area, useHighRes, time, 1, rightGain);
+        drawChannel (area.removeFromTop (area.getHeight() / 2), 0, leftGain);
+        drawChannel (area, 1, rightGain);
     }
     else if (useLeft)
     {
-        thumb.drawChannel (g, area, useHighRes, time, 0, leftGain);
+        drawChannel (area, 0, leftGain);
     }
     else if (useRight)
     {
-        thumb.drawChannel (g, area, useHighRes, time, 1, rightGain);
+        drawChannel (area, 1, rightGain);
     }
 }
 
@@ -386,68 +517,193 @@ void AudioClipComponent::updateThumbnail()
                     thumbnail = std::make_unique<te::SmartThumbnail> (wac->edit.engine, proxy, *this, &wac->edit);
                 else
                     thumbnail->setNewFile (proxy);
+                
+                setPeakPyramid (peakPyramidCache->getPyramid (proxy.getFile()));
             }
             else
             {
                 thumbnail = nullptr;
+                setPeakPyramid (nullptr);
             }
         }
     }
 }
 
+void AudioClipComponent::setPeakPyramid (PeakPyramid::Ptr newPyramid)
+{
+    if (newPyramid == peakPyramid)
+        return;
+
+    if (peakPyramid != nullptr)
+        peakPyramid->removeChangeListener (this);
+
+    peakPyramid = newPyramid;
+
+    if (peakPyramid != nullptr)
+        peakPyramid->addChangeListener (this);
+}
+
 //==============================================================================
 MidiClipComponent::MidiClipComponent (EditViewState& evs, te::Clip::Ptr c)
     : ClipComponent (evs, c)
 {
+    clip->state.addListener (this);
 }
 
-void MidiClipComponent::paint (Graphics& g)
+MidiClipComponent::~MidiClipComponent()
 {
-    ClipComponent::paint (g);
+    clip->state.removeListener (this);
+}
+
+void MidiClipComponent::valueTreeChanged()
+{
+    noteIndexIsDirty = true;
+    markAndUpdate (updateNotes);
+}
+
+void MidiClipComponent::handleAsyncUpdate()
+{
+    if (compareAndReset (updateNotes))
+        invalidateStaticLayer();
+}
+
+// The notes only change with the clip or the zoom, so they're part of the cached layer
+void MidiClipComponent::paintStaticLayer (Graphics& g)
+{
+    ClipComponent::paintStaticLayer (g);
+    
+    auto p = getParentComponent();
+    auto mc = getMidiClip();
+    
+    if (mc == nullptr || p == nullptr)
+        return;
+    
+    if (noteIndexIsDirty)
+    {
+        noteIndex.rebuild (mc->getSequence());
+        noteIndexIsDirty = false;
+    }
+    
+    // Only the part being repainted is looked at, in beats relative to the clip
+    const auto area = g.getClipBounds().getIntersection (getLocalBounds());
+    
+    if (area.isEmpty())
+        return;
+    
+    const auto clipStartBeat = mc->getStartBeat();
+    const auto startBeat = editViewState.timeToBeat (editViewState.xToTime (getX() + area.getX(), p->getWidth())) - clipStartBeat;
+    const auto endBeat = editViewState.timeToBeat (editViewState.xToTime (getX() + area.getRight(), p->getWidth())) - clipStartBeat;
+    const auto candidates = noteIndex.findNotesOverlapping (startBeat, endBeat);
+    
+    // Past a few notes per pixel, individual notes can't be told apart anyway
+    constexpr size_t maxNotesPerPixel = 4;
+    const auto beatsPerPixel = (endBeat - startBeat) / area.getWidth();
+    
+    if (candidates.getLength() > (size_t) area.getWidth() * maxNotesPerPixel && beatsPerPixel >= noteIndex.getBinLength (0))
+        drawNoteDensity (g, area, clipStartBeat);
+    else
+        drawNotes (g, *mc, candidates, startBeat, endBeat);
+}
+
+void MidiClipComponent::drawNotes (Graphics& g, te::MidiClip& mc, Range<size_t> candidates, double startBeat, double endBeat)
+{
+    auto p = getParentComponent();
+    const auto clipStartBeat = mc.getStartBeat();
+    const auto& notes = noteIndex.getNotes();
+    
+    for (auto i = candidates.getStart(); i < candidates.getEnd(); ++i)
+    {
+        const auto& n = notes[i];
+        
+        if (n.endBeat < startBeat || n.startBeat > endBeat)
+            continue;
+        
+        auto s = editViewState.beatToTime (clipStartBeat + n.startBeat);
+        auto e = editViewState.beatToTime (clipStartBeat + n.endBeat);
+        
+        auto t1 = (double) editViewState.timeToX (s, p->getWidth()) - getX();
+        auto t2 = (double) editViewState.timeToX (e, p->getWidth()) - getX();
+        
+        double y = (1.0 - double (n.noteNumber) / 127.0) * getHeight();
+        
+        g.setColour (Colours::white.withAlpha (n.velocity / 127.0f));
+        g.drawLine (float (t1), float (y), float (t2), float (y));
+    }
+}
+
+// One image column per pixel and one row per pitch, filled from the index's pitch masks
+void MidiClipComponent::drawNoteDensity (Graphics& g, Rectangle<int> area, double clipStartBeat)
+{
+    auto p = getParentComponent();
+    Image density (Image::ARGB, area.getWidth(), 128, true);
     
-    if (auto mc = getMidiClip())
     {
-        auto& seq = mc->getSequence();
-        for (auto n : seq.getNotes())
+        Image::BitmapData pixels (density, Image::BitmapData::writeOnly);
+        const auto colour = Colours::white.withAlpha (0.8f);
+        
+        auto columnBeat = [&] (int x)
         {
-            double sBeat = mc->getStartBeat() + n->getStartBeat();
-            double eBeat = mc->getStartBeat() + n->getEndBeat();
+            return editViewState.timeToBeat (editViewState.xToTime (getX() + area.getX() + x, p->getWidth())) - clipStartBeat;
+        };
+        
+        auto columnStart = columnBeat (0);
+        
+        for (int x = 0; x < area.getWidth(); ++x)
+        {
+            const auto columnEnd = columnBeat (x + 1);
+            const auto level = noteIndex.getLevelForBeatsPerPixel (columnEnd - columnStart);
+            const auto mask = noteIndex.getPitchesBetween (columnStart, columnEnd, level);
+            columnStart = columnEnd;
             
-            auto s = editViewState.beatToTime (sBeat);
-            auto e = editViewState.beatToTime (eBeat);
+            if (mask.isEmpty())
+                continue;
             
-            if (auto p = getParentComponent())
-            {
-                auto t1 = (double) editViewState.timeToX (s, p->getWidth()) - getX();
-                auto t2 = (double) editViewState.timeToX (e, p->getWidth()) - getX();
-                
-                double y = (1.0 - double (n->getNoteNumber()) / 127.0) * getHeight();
-                
-                g.setColour (Colours::white.withAlpha (n->getVelocity() / 127.0f));
-                g.drawLine (float (t1), float (y), float (t2), float (y));
-            }
+            for (int note = 0; note < 128; ++note)
+                if (mask.contains (note))
+                    pixels.setPixelColour (x, 127 - note, colour);
         }
     }
+    
+    Graphics::ScopedSaveState state (g);
+    g.setImageResamplingQuality (Graphics::lowResamplingQuality);
+    g.drawImage (density, area.getX(), 0, area.getWidth(), getHeight(), 0, 0, area.getWidth(), 128);
 }
 
 //==============================================================================
 RecordingClipComponent::RecordingClipComponent (te::Track::Ptr t, EditViewState& evs)
     : track (t), editViewState (evs)
 {
-    startTimerHz (10);
-    initialiseThumbnailAndPunchTime();
+    initialisePunchTime();
+    findTake();
+    frameClock->addClient (this);
+}
+
+RecordingClipComponent::~RecordingClipComponent()
+{
+    frameClock->removeClient (this);
 }
 
-void RecordingClipComponent::initialiseThumbnailAndPunchTime()
+void RecordingClipComponent::initialisePunchTime()
+{
+    if (auto at = dynamic_cast<te::AudioTrack*> (track.get()))
+        for (auto* idi : at->edit.getEditInputDevices().getDevicesForTargetTrack (*at))
+            punchInTime = idi->getPunchInTime();
+}
+
+// The registry may only pick the take up on its next frame, so this keeps looking until it has
+void RecordingClipComponent::findTake()
 {
     if (auto at = dynamic_cast<te::AudioTrack*> (track.get()))
     {
         for (auto* idi : at->edit.getEditInputDevices().getDevicesForTargetTrack (*at))
         {
-            punchInTime = idi->getPunchInTime();
-            
-            if (idi->getRecordingFile().exists())
-                thumbnail = at->edit.engine.getRecordingThumbnailManager().getThumbnailFor (idi->getRecordingFile());
+            if (auto t = takeRegistry->getTakeFor (*idi))
+            {
+                take = t;
+                numPeaksShown = 0;
+                waveformImage = {};
+                return;
+            }
         }
     }
 }
@@ -458,94 +714,100 @@ void RecordingClipComponent::paint (Graphics& g)
     g.setColour (Colours::black);
     g.drawRect (getLocalBounds());
     
-    if (editViewState.drawWaveforms)
-        drawThumbnail (g, Colours::black.withAlpha (0.5f));
+    if (editViewState.drawWaveforms && waveformImage.isValid())
+        g.drawImage (waveformImage, 0, 0, getWidth(), getHeight(), getX(), 0, getWidth(), getHeight());
 }
 
-void RecordingClipComponent::drawThumbnail (Graphics& g, Colour waveformColour) const
+Range<int> RecordingClipComponent::updateWaveformImage()
 {
-    if (thumbnail == nullptr)
-        return;
+    auto p = getParentComponent();
+    auto epc = track->edit.getTransport().getCurrentPlaybackContext();
     
-    Rectangle<int> bounds;
-    Range<double> times;
-    getBoundsAndTime (bounds, times);
-    auto w = bounds.getWidth();
+    if (p == nullptr || epc == nullptr || take == nullptr || p->getWidth() <= 0 || p->getHeight() <= 0)
+        return {};
+    
+    const auto& peaks = take->getPeaks();
+    const auto feedStartTime = take->getStartTime();
+    const auto secondsPerPeak = LivePeakFeed::samplesPerPeak / take->getSampleRate();
+    const auto takeLength = (double) peaks.size() * secondsPerPeak;
     
-    if (w > 0 && w < 10000)
+    // Once a loop has wrapped, the columns show the pass being recorded now
+    ImageKey key { editViewState.viewX1.get(), editViewState.viewX2.get(), 0.0, p->getWidth(), p->getHeight() };
+    
+    if (epc->isLooping())
     {
-        g.setColour (waveformColour);
-        thumbnail->thumb.drawChannels (g, bounds, w, times, 1.0f);
+        const auto loopTimes = epc->getLoopTimes();
+        
+        if (loopTimes.getLength() > 0.0 && feedStartTime + takeLength >= loopTimes.end)
+            key.loopOffset = std::floor ((feedStartTime + takeLength - loopTimes.start) / loopTimes.getLength()) * loopTimes.getLength();
     }
-}
-
-bool RecordingClipComponent::getBoundsAndTime (Rectangle<int>& bounds, Range<double>& times) const
-{
-    auto editTimeToX = [this] (double t)
+    
+    if (! (key == waveformImageKey) || ! waveformImage.isValid())
     {
-        if (auto p = getParentComponent())
-            return editViewState.timeToX (t, p->getWidth()) - getX();
-        return 0;
-    };
+        waveformImage = Image (Image::ARGB, key.width, key.height, true);
+        waveformImageKey = key;
+        waveformDrawnToX = 0;
+    }
     
-    auto xToEditTime = [this] (int x)
+    auto takeTimeAtX = [&] (int x)
     {
-        if (auto p = getParentComponent())
-            return editViewState.xToTime (x + getX(), p->getWidth());
-        return 0.0;
+        return editViewState.xToTime (x, key.width) + key.loopOffset - feedStartTime;
     };
     
-    bool hasLooped = false;
-    auto& edit = track->edit;
+    const auto firstX = waveformDrawnToX;
+    const auto centreY = key.height * 0.5f;
+    Graphics g (waveformImage);
+    g.setColour (Colours::black.withAlpha (0.5f));
     
-    if (auto epc = edit.getTransport().getCurrentPlaybackContext())
+    // Only whole columns are drawn, so each one is drawn exactly once
+    for (; waveformDrawnToX < key.width; ++waveformDrawnToX)
     {
-        auto localBounds = getLocalBounds();
-        
-        auto timeStarted = thumbnail->punchInTime;
-        auto unloopedPos = timeStarted + thumbnail->thumb.getTotalLength();
+        const auto t1 = takeTimeAtX (waveformDrawnToX + 1);
         
-        auto t1 = timeStarted;
-        auto t2 = unloopedPos;
+        if (t1 > takeLength)
+            break;
         
-        if (epc->isLooping() && t2 >= epc->getLoopTimes().end)
-        {
-            hasLooped = true;
-            
-            t1 = jmin (t1, epc->getLoopTimes().start);
-            t2 = epc->getPosition();
-            
-            t1 = jmax (editViewState.viewX1.get(), t1);
-            t2 = jmin (editViewState.viewX2.get(), t2);
-        }
-        else if (edit.recordingPunchInOut)
-        {
-            const double in  = thumbnail->punchInTime;
-            const double out = edit.getTransport().getLoopRange().getEnd();
-            
-            t1 = jlimit (in, out, t1);
-            t2 = jlimit (in, out, t2);
-        }
+        if (t1 <= 0.0)
+            continue;
         
-        bounds = localBounds.withX (jmax (localBounds.getX(), editTimeToX (t1)))
-                 .withRight (jmin (localBounds.getRight(), editTimeToX (t2)));
+        const auto first = (size_t) jmax (0.0, std::floor (takeTimeAtX (waveformDrawnToX) / secondsPerPeak));
+        const auto last = jlimit (first + 1, peaks.size(), (size_t) std::ceil (t1 / secondsPerPeak));
         
-        auto loopRange = epc->getLoopTimes();
-        const double recordedTime = unloopedPos - epc->getLoopTimes().start;
-        const int numLoops = (int) (recordedTime / loopRange.getLength());
+        LivePeakFeed::Peak column;
         
-        const Range<double> editTimes (xToEditTime (bounds.getX()),
-                                       xToEditTime (bounds.getRight()));
+        for (auto i = first; i < last; ++i)
+        {
+            column.min = jmin (column.min, peaks[i].min);
+            column.max = jmax (column.max, peaks[i].max);
+        }
         
-        times = (editTimes + (numLoops * loopRange.getLength())) - timeStarted;
+        g.drawVerticalLine (waveformDrawnToX,
+                            centreY - jlimit (-1.0f, 1.0f, column.max) * centreY,
+                            centreY - jlimit (-1.0f, 1.0f, column.min) * centreY + 1.0f);
     }
     
-    return hasLooped;
+    return { firstX, waveformDrawnToX };
 }
 
-void RecordingClipComponent::timerCallback()
+// The clip grows while recording, so it always counts as moving
+bool RecordingClipComponent::updateFrame (FrameClock::Frame&)
 {
     updatePosition();
+    
+    if (take == nullptr)
+        findTake();
+    
+    if (take != nullptr && take->getPeaks().size() != numPeaksShown && editViewState.drawWaveforms)
+    {
+        numPeaksShown = take->getPeaks().size();
+        
+        auto columns = updateWaveformImage();
+        
+        if (! columns.isEmpty())
+            repaint (columns.getStart() - getX(), 0, columns.getLength(), getHeight());
+    }
+    
+    return true;
 }
 
 void RecordingClipComponent::updatePosition()
@@ -688,6 +950,9 @@ TrackHeaderComponent::TrackHeaderComponent (EditViewState& evs, te::Track::Ptr t
         soloButton.onClick = [at] { at->setSolo (! at->isSolo (false)); };
         
         armButton.setToggleState (EngineHelpers::isTrackArmed (*at), dontSendNotification);
+        
+        meter = SharedResourcePointer<TrackMeterRegistry>()->getMeterFor (*at);
+        frameClock->addClient (this);
     }
     else
     {
@@ -700,28 +965,41 @@ TrackHeaderComponent::TrackHeaderComponent (EditViewState& evs, te::Track::Ptr t
     inputsState = track->edit.state.getChildWithName (te::IDs::INPUTDEVICES);
     inputsState.addListener (this);
     
-    valueTreePropertyChanged (track->state, te::IDs::mute);
-    valueTreePropertyChanged (track->state, te::IDs::solo);
-    valueTreePropertyChanged (inputsState, te::IDs::targetIndex);
+    updateMuteSolo = updateArm = true;
+    handleAsyncUpdate();
 }
 
 TrackHeaderComponent::~TrackHeaderComponent()
 {
+    frameClock->removeClient (this);
     track->state.removeListener (this);
+    inputsState.removeListener (this);
 }
 
 void TrackHeaderComponent::valueTreePropertyChanged (juce::ValueTree& v, const juce::Identifier& i)
 {
     if (te::TrackList::isTrack (v))
     {
-        if (i == te::IDs::mute)
-            muteButton.setToggleState ((bool)v[i], dontSendNotification);
-        else if (i == te::IDs::solo)
-            soloButton.setToggleState ((bool)v[i], dontSendNotification);
+        if (i == te::IDs::mute || i == te::IDs::solo)
+            markAndUpdate (updateMuteSolo);
     }
     else if (v.hasType (te::IDs::INPUTDEVICES)
              || v.hasType (te::IDs::INPUTDEVICE)
              || v.hasType (te::IDs::INPUTDEVICEDESTINATION))
+    {
+        markAndUpdate (updateArm);
+    }
+}
+
+void TrackHeaderComponent::handleAsyncUpdate()
+{
+    if (compareAndReset (updateMuteSolo))
+    {
+        muteButton.setToggleState ((bool) track->state[te::IDs::mute], dontSendNotification);
+        soloButton.setToggleState ((bool) track->state[te::IDs::solo], dontSendNotification);
+    }
+    
+    if (compareAndReset (updateArm))
     {
         if (auto at = dynamic_cast<te::AudioTrack*> (track.get()))
         {
@@ -741,6 +1019,45 @@ void TrackHeaderComponent::paint (Graphics& g)
         g.setColour (Colours::red);
         g.drawRect (getLocalBounds().withTrimmedRight (-4), 2);
     }
+    
+    if (meter != nullptr && ! meterArea.isEmpty())
+    {
+        auto r = meterArea.toFloat();
+        auto levelToWidth = [&r] (float gain)
+        {
+            return r.getWidth() * jlimit (0.0f, 1.0f, (Decibels::gainToDecibels (gain, -60.0f) + 60.0f) / 60.0f);
+        };
+        
+        auto bar = r.removeFromTop (r.getHeight() / 2).reduced (0.0f, 1.0f);
+        g.setColour (Colours::black);
+        g.fillRect (bar);
+        g.setColour (shownReading.peak >= 1.0f ? Colours::red : Colours::limegreen);
+        g.fillRect (bar.withWidth (levelToWidth (shownReading.averagePeak)));
+        g.setColour (Colours::white);
+        g.fillRect (bar.getX() + levelToWidth (shownReading.peak) - 1.0f, bar.getY(), 2.0f, bar.getHeight());
+        
+        g.setColour (shownReading.heldPluginLoad >= 1.0f ? Colours::red : Colours::white);
+        g.setFont (r.getHeight());
+        g.drawText ("Plugins " + String (shownReading.pluginLoad * 100.0f, 1) + "%", r, Justification::centredLeft);
+    }
+}
+
+bool TrackHeaderComponent::updateFrame (FrameClock::Frame&)
+{
+    auto reading = meter->takeReading();
+    
+    // Held peaks fall at about 20dB a second at 60Hz
+    reading.peak = jmax (reading.peak, shownReading.peak * 0.96f);
+    
+    auto moved = [] (float a, float b) { return std::abs (a - b) > 0.001f; };
+    
+    if (! (moved (reading.peak, shownReading.peak) || moved (reading.averagePeak, shownReading.averagePeak)
+           || moved (reading.pluginLoad, shownReading.pluginLoad) || moved (reading.heldPluginLoad, shownReading.heldPluginLoad)))
+        return false;
+    
+    shownReading = reading;
+    repaint (meterArea);
+    return true;
 }
 
 void TrackHeaderComponent::mouseDown (const MouseEvent&)
@@ -762,6 +1079,67 @@ void TrackHeaderComponent::resized()
     r.removeFromLeft (2);
     soloButton.setBounds (r.removeFromLeft (w));
     r.removeFromLeft (2);
+    
+    meterArea = r;
+}
+
+//==============================================================================
+TrackLoadListComponent::TrackLoadListComponent (te::Edit& e)
+    : edit (e)
+{
+    setSize (220, maxRows * rowHeight + 8);
+    frameClock->addClient (this);
+}
+
+TrackLoadListComponent::~TrackLoadListComponent()
+{
+    frameClock->removeClient (this);
+}
+
+// Re-sorted a few times a second, so the list can be read while it changes
+bool TrackLoadListComponent::updateFrame (FrameClock::Frame& frame)
+{
+    if (lastSortedFrame >= 0 && frame.getNumber() - lastSortedFrame < FrameClock::frameRateHz / 4)
+        return false;
+    
+    lastSortedFrame = frame.getNumber();
+    
+    std::vector<std::pair<String, float>> newRows;
+    
+    for (auto t : te::getAudioTracks (edit))
+        newRows.emplace_back (t->getName(), registry->getMeterFor (*t)->getPluginLoad());
+    
+    const auto numShown = jmin ((size_t) maxRows, newRows.size());
+    std::partial_sort (newRows.begin(), newRows.begin() + (std::ptrdiff_t) numShown, newRows.end(),
+                       [] (const auto& a, const auto& b) { return a.second > b.second; });
+    newRows.resize (numShown);
+    
+    if (newRows == rows)
+        return false;
+    
+    rows = std::move (newRows);
+    repaint();
+    return true;
+}
+
+void TrackLoadListComponent::paint (Graphics& g)
+{
+    g.fillAll (Colours::black);
+    g.setFont ((float) rowHeight * 0.7f);
+    
+    auto r = getLocalBounds().reduced (4);
+    
+    for (auto& row : rows)
+    {
+        auto rowArea = r.removeFromTop (rowHeight);
+        
+        g.setColour (Colours::steelblue);
+        g.fillRect (rowArea.withWidth (roundToInt (rowArea.getWidth() * jlimit (0.0f, 1.0f, row.second))).reduced (0, 1));
+        
+        g.setColour (Colours::white);
+        g.drawText (row.first, rowArea.reduced (4, 0), Justification::centredLeft);
+        g.drawText (String (row.second * 100.0f, 1) + "%", rowArea.reduced (4, 0), Justification::centredRight);
+    }
 }
 
 //==============================================================================
@@ -887,6 +1265,9 @@ TrackComponent::TrackComponent (EditViewState& evs, te::Track::Ptr t)
     track->state.addListener (this);
     track->edit.getTransport().addChangeListener (this);
     
+    // A row rebuilt mid-take (scrolled back into view) has missed the transport's
+    // broadcast, so it looks for a recording of its own
+    updateRecordClips = true;
     markAndUpdate (updateClips);
 }
 
@@ -899,6 +1280,7 @@ TrackComponent::~TrackComponent()
 void TrackComponent::paint (Graphics& g)
 {
     g.fillAll (Colours::grey);
+    editViewState.beatGrid.draw (g, editViewState, getWidth(), getHeight());
     
     if (editViewState.selectionManager.isSelected (track.get()))
     {
@@ -977,14 +1359,31 @@ void TrackComponent::resized()
     }
 }
 
+// Existing components are matched to clips by ID and kept, along with their
+// thumbnails and caches, so only clips that were added or removed cost anything
 void TrackComponent::buildClips()
 {
-    clips.clear();
+    std::unordered_map<uint64, std::unique_ptr<ClipComponent>> existing;
+    
+    for (auto cc : clips)
+        existing[cc->getClip().itemID.getRawID()].reset (cc);
+    
+    clips.clear (false);
     
     if (auto ct = dynamic_cast<te::ClipTrack*> (track.get()))
     {
         for (auto c : ct->getClips())
         {
+            auto found = existing.find (c->itemID.getRawID());
+            
+            // An undo can bring back a clip with the same ID as a new object
+            if (found != existing.end() && &found->second->getClip() == c)
+            {
+                clips.add (found->second.release());
+                existing.erase (found);
+                continue;
+            }
+            
             ClipComponent* cc = nullptr;
             
             if (dynamic_cast<te::WaveAudioClip*> (c))
@@ -1018,12 +1417,14 @@ void TrackComponent::buildRecordClips()
         }
     }
     
-    if (needed)
+    // The transport changes far more often than recording starts or stops, so an
+    // existing recording clip is kept rather than rebuilt with its thumbnail
+    if (needed && recordingClip == nullptr)
     {
         recordingClip = std::make_unique<RecordingClipComponent> (track, editViewState);
         addAndMakeVisible (*recordingClip);
     }
-    else
+    else if (! needed)
     {
         recordingClip = nullptr;
     }
@@ -1033,7 +1434,12 @@ void TrackComponent::buildRecordClips()
 PlayheadComponent::PlayheadComponent (te::Edit& e , EditViewState& evs)
     : edit (e), editViewState (evs)
 {
-    startTimerHz (30);
+    frameClock->addClient (this);
+}
+
+PlayheadComponent::~PlayheadComponent()
+{
+    frameClock->removeClient (this);
 }
 
 void PlayheadComponent::paint (Graphics& g)
@@ -1064,10 +1470,13 @@ void PlayheadComponent::mouseDrag (const MouseEvent& e)
 {
     double t = editViewState.xToTime (e.x, getWidth());
     edit.getTransport().setCurrentPosition (t);
-    timerCallback();
+    
+    FrameClock::Frame frame;
+    updateFrame (frame);
+    frameClock->wake();
 }
 
-void PlayheadComponent::timerCallback()
+bool PlayheadComponent::updateFrame (FrameClock::Frame& frame)
 {
     if (firstTimer)
     {
@@ -1076,12 +1485,15 @@ void PlayheadComponent::timerCallback()
         setMouseCursor (MouseCursor::LeftRightResizeCursor);
     }
 
-    int newX = editViewState.timeToX (edit.getTransport().getCurrentPosition(), getWidth());
+    int newX = editViewState.timeToX (frame.getPosition (edit.getTransport()), getWidth());
     if (newX != xPosition)
     {
         repaint (jmin (newX, xPosition) - 1, 0, jmax (newX, xPosition) - jmin (newX, xPosition) + 3, getHeight());
         xPosition = newX;
+        return true;
     }
+    
+    return false;
 }
 
 //==============================================================================
@@ -1090,6 +1502,7 @@ EditComponent::EditComponent (te::Edit& e, te::SelectionManager& sm)
 {
     edit.state.addListener (this);
     editViewState.selectionManager.addChangeListener (this);
+    takeRegistry->addEdit (edit);
     
     addAndMakeVisible (playhead);
     
@@ -1098,6 +1511,7 @@ EditComponent::EditComponent (te::Edit& e, te::SelectionManager& sm)
 
 EditComponent::~EditComponent()
 {
+    takeRegistry->removeEdit (edit);
     editViewState.selectionManager.removeChangeListener (this);
     edit.state.removeListener (this);
 }
@@ -1133,7 +1547,10 @@ void EditComponent::valueTreeChildAdded (juce::ValueTree&, juce::ValueTree& c)
 void EditComponent::valueTreeChildRemoved (juce::ValueTree&, juce::ValueTree& c, int)
 {
     if (te::TrackList::isTrack (c))
+    {
+        meterRegistry->removeMeterFor (te::EditItemID::fromID (c));
         markAndUpdate (updateTracks);
+    }
 }
 
 void EditComponent::valueTreeChildOrderChanged (juce::ValueTree& v, int a, int b)
@@ -1148,94 +1565,119 @@ void EditComponent::handleAsyncUpdate()
 {
     if (compareAndReset (updateTracks))
         buildTracks();
+    
     if (compareAndReset (updateZoom))
         resized();
 }
 
 void EditComponent::resized()
 {
-    jassert (headers.size() == tracks.size());
-    
-    const int trackHeight = 50, trackGap = 2;
     const int headerWidth = editViewState.showHeaders ? 150 : 0;
     const int footerWidth = editViewState.showFooters ? 150 : 0;
     
     playhead.setBounds (getLocalBounds().withTrimmedLeft (headerWidth).withTrimmedRight (footerWidth));
     
-    int y = roundToInt (editViewState.viewY.get());
-    for (int i = 0; i < jmin (headers.size(), tracks.size()); i++)
+    updateVisibleRows();
+    
+    const int y0 = roundToInt (editViewState.viewY.get());
+    
+    for (int i = 0; i < (int) rows.size(); i++)
     {
-        auto h = headers[i];
-        auto t = tracks[i];
-        auto f = footers[i];
+        auto& row = rows[(size_t) i];
+        
+        if (row.lane == nullptr)
+            continue;
         
-        h->setBounds (0, y, headerWidth, trackHeight);
-        t->setBounds (headerWidth, y, getWidth() - headerWidth - footerWidth, trackHeight);
-        f->setBounds (getWidth() - footerWidth, y, footerWidth, trackHeight);
+        const int y = y0 + i * (trackHeight + trackGap);
         
-        y += trackHeight + trackGap;
+        row.header->setBounds (0, y, headerWidth, trackHeight);
+        row.lane->setBounds (headerWidth, y, getWidth() - headerWidth - footerWidth, trackHeight);
+        row.footer->setBounds (getWidth() - footerWidth, y, footerWidth, trackHeight);
+        
+        // Its width may not have changed on a zoom, so the clips are laid out explicitly
+        row.lane->resized();
     }
-    
-    for (auto t : tracks)
-        t->resized();
 }
 
-void EditComponent::buildTracks()
+// Only the rows the user can see, plus a margin either side, have components. Rows
+// are created inside one margin but only released outside a wider one, so scrolling
+// back and forth near the edge doesn't keep rebuilding the same rows.
+void EditComponent::updateVisibleRows()
 {
-    tracks.clear();
-    headers.clear();
-    footers.clear();
+    const int rowHeight = trackHeight + trackGap;
+    const int y0 = roundToInt (editViewState.viewY.get());
     
-    for (auto t : getAllTracks (edit))
+    const int firstVisible = (int) std::floor (-y0 / (double) rowHeight);
+    const int lastVisible = (int) std::ceil ((getHeight() - y0) / (double) rowHeight);
+    const int margin = jmax (2, (lastVisible - firstVisible) / 2);
+    
+    const Range<int> realiseRange (firstVisible - margin, lastVisible + margin);
+    const Range<int> keepRange (realiseRange.getStart() - margin, realiseRange.getEnd() + margin);
+    
+    bool addedRows = false;
+    
+    for (int i = 0; i < (int) rows.size(); i++)
     {
-        TrackComponent* c = nullptr;
+        auto& row = rows[(size_t) i];
         
-        if (t->isMasterTrack())
-        {
-            if (editViewState.showMasterTrack)
-                c = new TrackComponent (editViewState, t);
-        }
-        else if (t->isTempoTrack())
+        if (row.lane == nullptr && realiseRange.contains (i))
         {
-            if (editViewState.showGlobalTrack)
-                c = new TrackComponent (editViewState, t);
-        }
-        else if (t->isMarkerTrack())
-        {
-            if (editViewState.showMarkerTrack)
-                c = new TrackComponent (editViewState, t);
+            row.lane = std::make_unique<TrackComponent> (editViewState, row.track);
+            row.header = std::make_unique<TrackHeaderComponent> (editViewState, row.track);
+            row.footer = std::make_unique<TrackFooterComponent> (editViewState, row.track);
+            
+            Helpers::addAndMakeVisible (*this, { row.lane.get(), row.header.get(), row.footer.get() });
+            addedRows = true;
         }
-        else if (t->isChordTrack())
+        else if (row.lane != nullptr && ! keepRange.contains (i))
         {
-            if (editViewState.showChordTrack)
-                c = new TrackComponent (editViewState, t);
+            row.lane = nullptr;
+            row.header = nullptr;
+            row.footer = nullptr;
         }
-        else if (t->isArrangerTrack())
+    }
+    
+    if (addedRows)
+        playhead.toFront (false);
+}
+
+// Rows for tracks that are still shown keep their components, only the list of rows is rebuilt
+void EditComponent::buildTracks()
+{
+    auto isShown = [this] (te::Track& t)
+    {
+        if (t.isMasterTrack())      return editViewState.showMasterTrack.get();
+        if (t.isTempoTrack())       return editViewState.showGlobalTrack.get();
+        if (t.isMarkerTrack())      return editViewState.showMarkerTrack.get();
+        if (t.isChordTrack())       return editViewState.showChordTrack.get();
+        if (t.isArrangerTrack())    return editViewState.showArrangerTrack.get();
+        
+        return true;
+    };
+    
+    std::unordered_map<te::Track*, TrackRow> existing;
+    
+    for (auto& row : rows)
+        existing[row.track.get()] = std::move (row);
+    
+    rows.clear();
+    
+    for (auto t : getAllTracks (edit))
+    {
+        if (! isShown (*t))
+            continue;
+        
+        if (auto found = existing.find (t); found != existing.end())
         {
-            if (editViewState.showArrangerTrack)
-                c = new TrackComponent (editViewState, t);
+            rows.push_back (std::move (found->second));
+            existing.erase (found);
         }
         else
         {
-            c = new TrackComponent (editViewState, t);
-        }
-        
-        if (c != nullptr)
-        {
-            tracks.add (c);
-            addAndMakeVisible (c);
-            
-            auto h = new TrackHeaderComponent (editViewState, t);
-            headers.add (h);
-            addAndMakeVisible (h);
-            
-            auto f = new TrackFooterComponent (editViewState, t);
-            footers.add (f);
-            addAndMakeVisible (f);
+            rows.push_back ({ t, nullptr, nullptr, nullptr });
         }
     }
     
-    playhead.toFront (false);
     resized();
 }
 
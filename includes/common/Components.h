@@ -8,6 +8,11 @@
 
 #pragma once
 #include "Utilities.h"
+#include "TempoMapIndex.h"
+#include "PeakPyramid.h"
+#include "MidiNoteIndex.h"
+#include "LivePeakFeed.h"
+#include "TrackMeter.h"
 
 namespace IDs
 {
@@ -32,6 +37,48 @@ namespace IDs
 
 namespace te = tracktion_engine;
 using namespace juce;
+
+class EditViewState;
+
+//==============================================================================
+/**
+    The bar and beat lines behind every lane.
+
+    They're drawn once into an image covering the visible range and a screen
+    either side of it, and every lane blits the same image at the current
+    scroll offset. It's only drawn again when the zoom, the lane size or the
+    tempo map changes, or the view scrolls off the end of it.
+*/
+class BeatGridCache
+{
+public:
+    void draw (Graphics&, EditViewState&, int width, int height);
+    
+private:
+    struct Key
+    {
+        double secondsPerPixel = 0.0;
+        int width = 0, height = 0;
+        float scale = 1.0f;
+        uint32 tempoVersion = 0;
+        
+        bool operator== (const Key& o) const noexcept
+        {
+            return secondsPerPixel == o.secondsPerPixel && width == o.width && height == o.height
+                    && scale == o.scale && tempoVersion == o.tempoVersion;
+        }
+    };
+    
+    static constexpr int screensPerImage = 3;
+    static constexpr float minPixelsPerBeat = 8.0f, minPixelsPerBar = 4.0f;
+    
+    Key key;
+    Image image;
+    double imageStartTime = 0.0;
+    
+    void render (EditViewState&);
+};
+
 //==============================================================================
 class EditViewState
 {
@@ -71,12 +118,18 @@ public:
     
     double beatToTime (double b) const
     {
-        auto& ts = edit.tempoSequence;
-        return ts.beatsToTime (b);
+        return tempoMap->beatsToTime (b);
+    }
+    
+    double timeToBeat (double t) const
+    {
+        return tempoMap->timeToBeats (t);
     }
     
     te::Edit& edit;
     te::SelectionManager& selectionManager;
+    std::unique_ptr<TempoMapIndex> tempoMap { std::make_unique<TempoMapIndex> (edit.tempoSequence) };
+    BeatGridCache beatGrid;
     
     CachedValue<bool> showMasterTrack, showGlobalTrack, showMarkerTrack, showChordTrack, showArrangerTrack,
                       drawWaveforms, showHeaders, showFooters, showMidiDevices, showWaveDevices;
@@ -98,22 +151,60 @@ public:
     te::Clip& getClip() { return *clip; }
     
 protected:
+    /** Everything about the clip that only changes with its state or the zoom. The
+        part in view, and a little either side, is drawn into an image that paint()
+        blits until the view leaves that span, the size, zoom, colour, name or tempo
+        map changes, or a subclass calls invalidateStaticLayer().
+    */
+    virtual void paintStaticLayer (Graphics&);
+    void invalidateStaticLayer();
+    
     EditViewState& editViewState;
     te::Clip::Ptr clip;
+    
+private:
+    struct StaticLayerKey
+    {
+        int width = 0, height = 0;
+        float scale = 1.0f;
+        double secondsPerPixel = 0.0, clipStart = 0.0;
+        uint32 colour = 0, tempoVersion = 0;
+        String name;
+        
+        bool operator== (const StaticLayerKey& o) const noexcept
+        {
+            return width == o.width && height == o.height && scale == o.scale
+                    && secondsPerPixel == o.secondsPerPixel && clipStart == o.clipStart
+                    && colour == o.colour && tempoVersion == o.tempoVersion && name == o.name;
+        }
+    };
+    
+    // Only the visible part is kept, so a long clip costs no more than one the width
+    // of the lane. The margin lets a short scroll reuse the image.
+    static constexpr int cachedMargin = 256;
+    
+    Image staticLayer;
+    StaticLayerKey staticLayerKey;
+    Rectangle<int> staticLayerArea;
 };
 
 //==============================================================================
-class AudioClipComponent : public ClipComponent
+class AudioClipComponent : public ClipComponent,
+                           private ChangeListener
 {
 public:
     AudioClipComponent (EditViewState&, te::Clip::Ptr);
+    ~AudioClipComponent() override;
     
     te::WaveAudioClip* getWaveAudioClip() { return dynamic_cast<te::WaveAudioClip*> (clip.get()); }
     
     void paint (Graphics& g) override;
     
 private:
+    void changeListenerCallback (ChangeBroadcaster*) override { repaint(); }
+    
     void updateThumbnail();
+    void setPeakPyramid (PeakPyramid::Ptr);
     void drawWaveform (Graphics& g, te::AudioClipBase& c, te::SmartThumbnail& thumb, Colour colour,
                        int left, int right, int y, int h, int xOffset);
     void drawChannels (Graphics& g, te::SmartThumbnail& thumb, Rectangle<int> area, bool useHighRes,
@@ -121,45 +212,91 @@ private:
                        float leftGain, float rightGain);
 
     std::unique_ptr<te::SmartThumbnail> thumbnail;
+    
+    // Drawn from when it's ready and the zoom allows, the thumbnail covers everything else
+    SharedResourcePointer<PeakPyramidCache> peakPyramidCache;
+    PeakPyramid::Ptr peakPyramid;
 };
 
 //==============================================================================
-class MidiClipComponent : public ClipComponent
+class MidiClipComponent : public ClipComponent,
+                          private te::ValueTreeAllEventListener,
+                          private FlaggedAsyncUpdater
 {
 public:
     MidiClipComponent (EditViewState&, te::Clip::Ptr);
+    ~MidiClipComponent() override;
     
     te::MidiClip* getMidiClip() { return dynamic_cast<te::MidiClip*> (clip.get()); }
     
-    void paint (Graphics& g) override;
+private:
+    void paintStaticLayer (Graphics&) override;
+    
+    void valueTreeChanged() override;
+    void handleAsyncUpdate() override;
+    
+    void drawNotes (Graphics&, te::MidiClip&, Range<size_t> candidates, double startBeat, double endBeat);
+    void drawNoteDensity (Graphics&, Rectangle<int> area, double clipStartBeat);
+    
+    // Rebuilt lazily on the next paint after the clip's state changes
+    MidiNoteIndex noteIndex;
+    bool noteIndexIsDirty = true, updateNotes = false;
 };
 
 //==============================================================================
 class RecordingClipComponent : public Component,
-                               private Timer
+                               private FrameClock::Client
 {
 public:
     RecordingClipComponent (te::Track::Ptr t, EditViewState&);
+    ~RecordingClipComponent() override;
     
     void paint (Graphics& g) override;
     
 private:
-    void timerCallback() override;
+    bool updateFrame (FrameClock::Frame&) override;
     void updatePosition();
-    void initialiseThumbnailAndPunchTime();
-    void drawThumbnail (Graphics& g, Colour waveformColour) const;
-    bool getBoundsAndTime (Rectangle<int>& bounds, Range<double>& times) const;
+    void initialisePunchTime();
+    void findTake();
+    Range<int> updateWaveformImage();
     
     te::Track::Ptr track;
     EditViewState& editViewState;
     
-    te::RecordingThumbnailManager::Thumbnail::Ptr thumbnail;
     double punchInTime = -1.0;
+    
+    // The take so far, gathered by the registry whether or not this is showing it.
+    // The image is in the parent's coordinates and only the columns the take has
+    // grown into since the last frame are drawn, until the zoom or loop pass
+    // changes and it starts over.
+    SharedResourcePointer<LiveTakeRegistry> takeRegistry;
+    LiveTake::Ptr take;
+    size_t numPeaksShown = 0;
+    
+    struct ImageKey
+    {
+        double viewStart = 0.0, viewEnd = 0.0, loopOffset = 0.0;
+        int width = 0, height = 0;
+        
+        bool operator== (const ImageKey& o) const noexcept
+        {
+            return viewStart == o.viewStart && viewEnd == o.viewEnd && loopOffset == o.loopOffset
+                    && width == o.width && height == o.height;
+        }
+    };
+    
+    Image waveformImage;
+    ImageKey waveformImageKey;
+    int waveformDrawnToX = 0;
+    
+    SharedResourcePointer<FrameClock> frameClock;
 };
 
 //==============================================================================
 class TrackHeaderComponent : public Component,
-                             private te::ValueTreeAllEventListener
+                             private FlaggedAsyncUpdater,
+                             private te::ValueTreeAllEventListener,
+                             private FrameClock::Client
 {
 public:
     TrackHeaderComponent (EditViewState&, te::Track::Ptr);
@@ -173,12 +310,47 @@ private:
     void valueTreeChanged() override {}
     void valueTreePropertyChanged (juce::ValueTree&, const juce::Identifier&) override;
     
+    void handleAsyncUpdate() override;
+    bool updateFrame (FrameClock::Frame&) override;
+    
     EditViewState& editViewState;
     te::Track::Ptr track;
     
     ValueTree inputsState;
     Label trackName;
     TextButton armButton {"A"}, muteButton {"M"}, soloButton {"S"}, inputButton {"I"};
+    
+    bool updateMuteSolo = false, updateArm = false;
+    
+    // Only audio tracks have a meter. The peak falls back slowly once the meter lets go of it
+    TrackMeter::Ptr meter;
+    TrackMeter::Reading shownReading;
+    Rectangle<int> meterArea;
+    SharedResourcePointer<FrameClock> frameClock;
+};
+
+//==============================================================================
+/** The audio tracks whose plugins take the most of the block budget, heaviest first. */
+class TrackLoadListComponent : public Component,
+                               private FrameClock::Client
+{
+public:
+    TrackLoadListComponent (te::Edit&);
+    ~TrackLoadListComponent() override;
+    
+    void paint (Graphics&) override;
+    
+    static constexpr int maxRows = 8, rowHeight = 18;
+    
+private:
+    bool updateFrame (FrameClock::Frame&) override;
+    
+    te::Edit& edit;
+    SharedResourcePointer<TrackMeterRegistry> registry;
+    SharedResourcePointer<FrameClock> frameClock;
+    
+    std::vector<std::pair<String, float>> rows;
+    int64 lastSortedFrame = -1;
 };
 
 //==============================================================================
@@ -268,10 +440,11 @@ private:
 
 //==============================================================================
 class PlayheadComponent : public Component,
-                          private Timer
+                          private FrameClock::Client
 {
 public:
     PlayheadComponent (te::Edit&, EditViewState&);
+    ~PlayheadComponent() override;
     
     void paint (Graphics& g) override;
     bool hitTest (int x, int y) override;
@@ -280,10 +453,11 @@ public:
     void mouseUp (const MouseEvent&) override;
 
 private:
-    void timerCallback() override;
+    bool updateFrame (FrameClock::Frame&) override;
     
     te::Edit& edit;
     EditViewState& editViewState;
+    SharedResourcePointer<FrameClock> frameClock;
     
     int xPosition = 0;
     bool firstTimer = true;
@@ -316,15 +490,30 @@ private:
 
     
     void buildTracks();
+    void updateVisibleRows();
     
     te::Edit& edit;
     
     EditViewState editViewState;
     
     PlayheadComponent playhead {edit, editViewState};
-    OwnedArray<TrackComponent> tracks;
-    OwnedArray<TrackHeaderComponent> headers;
-    OwnedArray<TrackFooterComponent> footers;
+    
+    // One row per shown track; the components are only there while it's near the view
+    struct TrackRow
+    {
+        te::Track::Ptr track;
+        std::unique_ptr<TrackComponent> lane;
+        std::unique_ptr<TrackHeaderComponent> header;
+        std::unique_ptr<TrackFooterComponent> footer;
+    };
+    
+    std::vector<TrackRow> rows;
+    SharedResourcePointer<TrackMeterRegistry> meterRegistry;
+    
+    // Holds the takes for as long as the edit is shown, so rows can come and go mid-take
+    SharedResourcePointer<LiveTakeRegistry> takeRegistry;
+    
+    static constexpr int trackHeight = 50, trackGap = 2;
     
     bool updateTracks = false, updateZoom = false;
 };
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace te = tracktion_engine;
+using namespace juce;
+
+//==============================================================================
+/**
+    One timer for everything on screen that animates.
+
+    Clients are updated together once per frame, in a single pass on the message
+    thread, so the playhead, recording clips and thumbnails all move on the same
+    frame and their repaints are coalesced into one paint. Each transport's
+    position is read at most once per frame, however many clients ask for it.
+
+    Clients return whether anything moved. Once nothing has for a while the clock
+    drops to a slow idle rate, and goes back to full rate as soon as something does.
+
+    Get at it through a SharedResourcePointer<FrameClock>.
+*/
+class FrameClock  : private Timer
+{
+public:
+    //==============================================================================
+    /** What the clients are given each frame. */
+    class Frame
+    {
+    public:
+        /** The transport's position this frame, the same for every client that asks. */
+        double getPosition (te::TransportControl& transport)
+        {
+            for (auto& p : positions)
+                if (p.first == &transport)
+                    return p.second;
+
+            const auto position = transport.getCurrentPosition();
+            positions.add ({ &transport, position });
+            return position;
+        }
+
+        int64 getNumber() const noexcept    { return number; }
+
+    private:
+        friend class FrameClock;
+
+        int64 number = 0;
+        Array<std::pair<te::TransportControl*, double>> positions;
+    };
+
+    struct Client
+    {
+        virtual ~Client() = default;
+
+        /** Called once per frame. Return true if anything moved or changed. */
+        virtual bool updateFrame (Frame&) = 0;
+    };
+
+    //==============================================================================
+    static constexpr int frameRateHz = 60;
+    static constexpr int idleRateHz = 10;
+    static constexpr int framesBeforeIdle = 30;
+
+    FrameClock() = default;
+
+    ~FrameClock() override
+    {
+        jassert (clients.isEmpty());
+        stopTimer();
+    }
+
+    void addClient (Client* c)
+    {
+        clients.addIfNotAlreadyThere (c);
+        wake();
+    }
+
+    void removeClient (Client* c)
+    {
+        clients.removeFirstMatchingValue (c);
+
+        if (clients.isEmpty())
+            stopTimer();
+    }
+
+    /** Goes back to the full frame rate straight away, e.g. after a user edit. */
+    void wake()
+    {
+        framesSinceLastChange = 0;
+
+        if (! clients.isEmpty() && getTimerInterval() != 1000 / frameRateHz)
+            startTimerHz (frameRateHz);
+    }
+
+private:
+    Array<Client*> clients;
+    Frame frame;
+    int framesSinceLastChange = 0;
+
+    void timerCallback() override
+    {
+        ++frame.number;
+        frame.positions.clearQuick();
+
+        bool anythingMoved = false;
+
+        // Clients may remove themselves (or others) while being updated
+        for (int i = clients.size(); --i >= 0;)
+            if (auto c = clients[i])
+                anythingMoved = c->updateFrame (frame) || anythingMoved;
+
+        if (anythingMoved)
+            wake();
+        else if (++framesSinceLastChange == framesBeforeIdle)
+            startTimerHz (idleRateHz);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (FrameClock)
+};
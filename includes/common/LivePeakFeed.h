@@ -0,0 +1,297 @@
+#pragma once
+
+#include "Utilities.h"
+
+//==============================================================================
+/**
+    Min/max peaks of an input as it's being recorded, for drawing the take live.
+
+    It's a consumer of the input device, so the audio thread hands it every block
+    the recording is made from. It folds each block into one peak per
+    samplesPerPeak samples and pushes them through a lock-free single-producer
+    ring, so the drawing never reads back from the file being written.
+
+    The message thread drains the ring into the take's peaks once per frame.
+    Every peak carries its index, so if the ring ever overflows the lost peaks
+    come out as silence and everything after them stays in the right place.
+*/
+class LivePeakFeed  : public te::InputDeviceInstance::Consumer
+{
+public:
+    struct Peak
+    {
+        float min = 0.0f, max = 0.0f;
+    };
+
+    static constexpr int samplesPerPeak = 256;
+
+    LivePeakFeed (int capacity = 8192)
+        : fifo (capacity), entries ((size_t) capacity)
+    {
+    }
+
+    //==============================================================================
+    /** Audio thread. Every channel of the input is folded into the same peak. */
+    void acceptInputBuffer (const dsp::AudioBlock<float>& block) override
+    {
+        const auto numSamples = (int) block.getNumSamples();
+
+        for (int start = 0; start < numSamples;)
+        {
+            const auto num = jmin (samplesPerPeak - numPending, numSamples - start);
+
+            for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+            {
+                const auto range = FloatVectorOperations::findMinAndMax (block.getChannelPointer (ch) + start, num);
+                pending.min = jmin (pending.min, range.getStart());
+                pending.max = jmax (pending.max, range.getEnd());
+            }
+
+            start += num;
+            numPending += num;
+
+            if (numPending == samplesPerPeak)
+            {
+                push (pending);
+                pending = {};
+                numPending = 0;
+            }
+        }
+    }
+
+    //==============================================================================
+    /** Message thread. Appends whatever has arrived since the last call and
+        returns the number of peaks added.
+    */
+    int drainInto (std::vector<Peak>& peaks)
+    {
+        const auto numBefore = peaks.size();
+
+        int start1, size1, start2, size2;
+        fifo.prepareToRead (fifo.getNumReady(), start1, size1, start2, size2);
+
+        auto append = [&] (int start, int num)
+        {
+            for (int i = start; i < start + num; ++i)
+            {
+                auto& e = entries[(size_t) i];
+
+                if ((size_t) e.index >= peaks.size())
+                    peaks.resize ((size_t) e.index + 1);
+
+                peaks[(size_t) e.index] = e.peak;
+            }
+        };
+
+        append (start1, size1);
+        append (start2, size2);
+        fifo.finishedRead (size1 + size2);
+
+        return (int) (peaks.size() - numBefore);
+    }
+
+    int getNumDropped() const noexcept      { return numDropped.load (std::memory_order_relaxed); }
+
+private:
+    struct Entry
+    {
+        int64 index = 0;
+        Peak peak;
+    };
+
+    AbstractFifo fifo;
+    std::vector<Entry> entries;
+    std::atomic<int> numDropped { 0 };
+
+    // Audio thread only
+    Peak pending;
+    int numPending = 0;
+    int64 numPushed = 0;
+
+    void push (Peak p) noexcept
+    {
+        const auto index = numPushed++;
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+        if (size1 == 0)
+        {
+            numDropped.fetch_add (1, std::memory_order_relaxed);
+            return;
+        }
+
+        entries[(size_t) start1] = { index, p };
+        fifo.finishedWrite (1);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (LivePeakFeed)
+};
+
+//==============================================================================
+/**
+    The peaks of one input's take so far. They're gathered from the moment the
+    input is seen recording until it stops, whether or not any view is showing
+    them, so a view built part way through a take can still draw all of it.
+*/
+class LiveTake  : public ReferenceCountedObject
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<LiveTake>;
+
+    LiveTake (te::InputDeviceInstance& in, double takeStartTime, double takeSampleRate)
+        : edit (in.edit), input (&in), context (&in.context), startTime (takeStartTime), sampleRate (takeSampleRate)
+    {
+    }
+
+    /** Message thread. Every peak that has arrived, from the start of the take. */
+    const std::vector<LivePeakFeed::Peak>& getPeaks() const noexcept    { return peaks; }
+
+    double getStartTime() const noexcept                                { return startTime; }
+    double getSampleRate() const noexcept                               { return sampleRate; }
+    const te::InputDeviceInstance* getInput() const noexcept            { return input; }
+
+private:
+    friend class LiveTakeRegistry;
+
+    LivePeakFeed feed;
+    std::vector<LivePeakFeed::Peak> peaks;
+
+    te::Edit& edit;
+
+    // Only compared against the playback context's current inputs, never followed
+    // unless they're still there
+    te::InputDeviceInstance* input;
+    te::EditPlaybackContext* context;
+    double startTime, sampleRate;
+    bool registered = false;
+
+    JUCE_DECLARE_NON_COPYABLE (LiveTake)
+};
+
+//==============================================================================
+/**
+    Keeps a LiveTake for every input that is recording in the Edits it watches,
+    so the feeds belong to the inputs rather than to the views drawing them.
+
+    A take's feed stays registered with its InputDeviceInstance until the input
+    stops recording. It's only taken off while the instance is still one of its
+    playback context's inputs: once the context has been freed, the instance has
+    gone and taken its consumers with it.
+
+    Get at it through a SharedResourcePointer<LiveTakeRegistry>. Message thread only.
+*/
+class LiveTakeRegistry  : private FrameClock::Client
+{
+public:
+    LiveTakeRegistry() = default;
+
+    ~LiveTakeRegistry() override
+    {
+        frameClock->removeClient (this);
+
+        for (auto& t : takes)
+            unregister (*t.second);
+    }
+
+    /** Starts watching an Edit's inputs, until removeEdit. */
+    void addEdit (te::Edit& edit)
+    {
+        edits.addIfNotAlreadyThere (&edit);
+        frameClock->addClient (this);
+    }
+
+    void removeEdit (te::Edit& edit)
+    {
+        for (auto it = takes.begin(); it != takes.end();)
+        {
+            if (&it->second->edit == &edit)
+            {
+                unregister (*it->second);
+                it = takes.erase (it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        edits.removeFirstMatchingValue (&edit);
+
+        if (edits.isEmpty())
+            frameClock->removeClient (this);
+    }
+
+    /** The take being recorded from an input, or nullptr if it isn't recording. */
+    LiveTake::Ptr getTakeFor (const te::InputDeviceInstance& input) const
+    {
+        for (auto& t : takes)
+            if (t.first == &input)
+                return t.second;
+
+        return {};
+    }
+
+private:
+    SharedResourcePointer<FrameClock> frameClock;
+    Array<te::Edit*> edits;
+    std::vector<std::pair<te::InputDeviceInstance*, LiveTake::Ptr>> takes;
+
+    static bool isStillRunning (const LiveTake& t)
+    {
+        auto epc = t.edit.getTransport().getCurrentPlaybackContext();
+        return epc == t.context && epc->getAllInputs().contains (t.input);
+    }
+
+    void unregister (LiveTake& t)
+    {
+        if (t.registered && isStillRunning (t))
+            t.input->removeConsumer (&t.feed);
+
+        t.registered = false;
+    }
+
+    // Drained every frame, so the rings never fill up while nothing is drawing them
+    bool updateFrame (FrameClock::Frame&) override
+    {
+        bool anythingArrived = false;
+
+        for (auto it = takes.begin(); it != takes.end();)
+        {
+            auto& take = *it->second;
+
+            if (! isStillRunning (take) || ! take.input->isRecording())
+            {
+                unregister (take);
+                it = takes.erase (it);
+                continue;
+            }
+
+            anythingArrived = take.feed.drainInto (take.peaks) > 0 || anythingArrived;
+            ++it;
+        }
+
+        for (auto edit : edits)
+        {
+            if (auto epc = edit->getTransport().getCurrentPlaybackContext())
+            {
+                for (auto input : epc->getAllInputs())
+                {
+                    if (! input->isRecording() || getTakeFor (*input) != nullptr)
+                        continue;
+
+                    LiveTake::Ptr take = new LiveTake (*input, epc->getUnloopedPosition(),
+                                                       edit->engine.getDeviceManager().getSampleRate());
+                    input->addConsumer (&take->feed);
+                    take->registered = true;
+                    takes.emplace_back (input, take);
+                    anythingArrived = true;
+                }
+            }
+        }
+
+        return anythingArrived;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (LiveTakeRegistry)
+};
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "Utilities.h"
+
+//==============================================================================
+/**
+    A MIDI clip's notes flattened for drawing.
+
+    The notes are kept sorted by start beat alongside a running maximum of their
+    end beats, so the notes overlapping any range are found with two binary
+    searches: everything that starts before the range ends, from the first note
+    whose running maximum end reaches into it.
+
+    For zoomed-out drawing there is also a ladder of pitch masks. Level 0 has
+    one 128-bit mask per bin of getBinLength (0) beats, with a bit set for every
+    pitch sounding in it, and each level above ORs pairs of the level below.
+    Drawing a column then reads at most a couple of masks whatever the number
+    of notes behind them.
+*/
+class MidiNoteIndex
+{
+public:
+    struct Note
+    {
+        double startBeat = 0.0, endBeat = 0.0;
+        uint8 noteNumber = 0, velocity = 0;
+    };
+
+    struct PitchMask
+    {
+        uint64 bits[2] = {};
+
+        bool isEmpty() const noexcept                   { return (bits[0] | bits[1]) == 0; }
+        bool contains (int note) const noexcept         { return (bits[note >> 6] >> (note & 63) & 1) != 0; }
+        void add (int note) noexcept                    { bits[note >> 6] |= uint64 (1) << (note & 63); }
+        void add (const PitchMask& other) noexcept      { bits[0] |= other.bits[0]; bits[1] |= other.bits[1]; }
+    };
+
+    //==============================================================================
+    void rebuild (const te::MidiList& sequence)
+    {
+        notes.clear();
+
+        for (auto n : sequence.getNotes())
+            notes.push_back ({ n->getStartBeat(), n->getEndBeat(),
+                               (uint8) jlimit (0, 127, n->getNoteNumber()), (uint8) jlimit (0, 127, n->getVelocity()) });
+
+        std::sort (notes.begin(), notes.end(), [] (const Note& a, const Note& b) { return a.startBeat < b.startBeat; });
+
+        maxEndBeats.resize (notes.size());
+        double maxEnd = std::numeric_limits<double>::lowest();
+
+        for (size_t i = 0; i < notes.size(); ++i)
+            maxEndBeats[i] = maxEnd = jmax (maxEnd, notes[i].endBeat);
+
+        buildMasks();
+    }
+
+    const std::vector<Note>& getNotes() const noexcept      { return notes; }
+
+    /** Indexes of the notes that may overlap a beat range. Every note that does
+        is inside it; a note inside it that ends before startBeat doesn't.
+    */
+    Range<size_t> findNotesOverlapping (double startBeat, double endBeat) const
+    {
+        const auto first = (size_t) (std::upper_bound (maxEndBeats.begin(), maxEndBeats.end(), startBeat) - maxEndBeats.begin());
+        const auto last = (size_t) (std::lower_bound (notes.begin(), notes.end(), endBeat,
+                                                      [] (const Note& n, double b) { return n.startBeat < b; }) - notes.begin());
+
+        return { first, jmax (first, last) };
+    }
+
+    //==============================================================================
+    int getNumLevels() const noexcept                       { return (int) levels.size(); }
+    double getBinLength (int level) const noexcept          { return baseBinLength * (double) (1 << level); }
+
+    /** The coarsest level whose bins are no longer than the given number of beats. */
+    int getLevelForBeatsPerPixel (double beatsPerPixel) const noexcept
+    {
+        int level = 0;
+
+        while (level + 1 < getNumLevels() && getBinLength (level + 1) <= beatsPerPixel)
+            ++level;
+
+        return level;
+    }
+
+    /** Every pitch sounding somewhere between two beats, from one level's bins. */
+    PitchMask getPitchesBetween (double startBeat, double endBeat, int level) const noexcept
+    {
+        PitchMask mask;
+
+        if (! isPositiveAndBelow (level, getNumLevels()))
+            return mask;
+
+        const auto& bins = levels[(size_t) level];
+        const auto binLength = getBinLength (level);
+        const auto first = jmax ((int64) 0, (int64) std::floor ((startBeat - firstBeat) / binLength));
+        const auto last = jmin ((int64) bins.size(), (int64) std::ceil ((endBeat - firstBeat) / binLength));
+
+        for (auto i = first; i < last; ++i)
+            mask.add (bins[(size_t) i]);
+
+        return mask;
+    }
+
+private:
+    static constexpr int maxBaseBins = 1 << 16;
+
+    std::vector<Note> notes;
+    std::vector<double> maxEndBeats;
+
+    double firstBeat = 0.0, baseBinLength = 0.25;
+    std::vector<std::vector<PitchMask>> levels;
+
+    // Sixteenth-note bins, or longer for very long clips so the base level stays bounded
+    void buildMasks()
+    {
+        levels.clear();
+
+        if (notes.empty())
+            return;
+
+        firstBeat = notes.front().startBeat;
+        const auto length = jmax (1.0, maxEndBeats.back() - firstBeat);
+        baseBinLength = jmax (0.25, length / maxBaseBins);
+
+        std::vector<PitchMask> base ((size_t) std::ceil (length / baseBinLength) + 1);
+
+        for (auto& n : notes)
+        {
+            const auto first = (size_t) ((n.startBeat - firstBeat) / baseBinLength);
+            const auto last = jmax (first + 1, jmin (base.size(), (size_t) std::ceil ((n.endBeat - firstBeat) / baseBinLength)));
+
+            for (auto i = first; i < last; ++i)
+                base[i].add (n.noteNumber);
+        }
+
+        levels.push_back (std::move (base));
+
+        while (levels.back().size() > 1)
+        {
+            const auto& below = levels.back();
+            std::vector<PitchMask> level ((below.size() + 1) / 2);
+
+            for (size_t i = 0; i < below.size(); ++i)
+                level[i / 2].add (below[i]);
+
+            levels.push_back (std::move (level));
+        }
+    }
+};
@@ -0,0 +1,434 @@
+#pragma once
+
+#include "Utilities.h"
+
+//==============================================================================
+/**
+    Min/max/RMS peaks for an audio file at a ladder of resolutions.
+
+    Level 0 has one peak per baseSamplesPerPeak samples and each level above it
+    summarises levelRatio peaks of the one below, so for any zoom there is a level
+    with between one and levelRatio peaks per pixel and drawing reads a handful of
+    values per column, however long the file.
+
+    The pyramid is built on a background thread, saved next to the file (or in
+    the temp folder if that can't be written to) and loaded from there next
+    time, as long as the file hasn't changed since. It's a ChangeBroadcaster
+    that sends a message once it's ready; until then isReady() is false and the
+    caller should draw some other way.
+*/
+class PeakPyramid  : public ReferenceCountedObject,
+                     public ChangeBroadcaster
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<PeakPyramid>;
+
+    static constexpr int baseSamplesPerPeak = 256;
+    static constexpr int levelRatio = 4;
+
+    PeakPyramid (const File& f)  : file (f) {}
+
+    const File& getFile() const noexcept    { return file; }
+    bool isReady() const noexcept           { return ready.load (std::memory_order_acquire); }
+    bool hasFailed() const noexcept         { return failed.load (std::memory_order_acquire); }
+
+    int getNumChannels() const noexcept     { return isReady() ? numChannels : 0; }
+
+    /** Any thread, once ready. False if the file has been rewritten since these peaks were made. */
+    bool matchesFile() const
+    {
+        return file.getSize() == fileSize && file.getLastModificationTime().toMilliseconds() == fileModificationTime;
+    }
+    double getSampleRate() const noexcept   { return sampleRate; }
+
+    //==============================================================================
+    /** Draws one channel of the file between two times (in seconds) into an area.
+        Returns false without drawing if the pyramid isn't ready or the zoom is finer
+        than its base level, when the samples themselves are needed.
+    */
+    bool drawChannel (Graphics& g, Rectangle<int> area, Range<double> time, int channel, float gain) const
+    {
+        if (! isReady() || area.isEmpty() || time.isEmpty() || ! isPositiveAndBelow (channel, numChannels))
+            return false;
+
+        const auto samplesPerPixel = time.getLength() * sampleRate / area.getWidth();
+
+        if (samplesPerPixel < baseSamplesPerPeak)
+            return false;
+
+        // The coarsest level that still has at least one peak per pixel
+        int levelIndex = 0;
+        double samplesPerPeak = baseSamplesPerPeak;
+
+        while (levelIndex + 1 < (int) levels.size() && samplesPerPeak * levelRatio <= samplesPerPixel)
+        {
+            ++levelIndex;
+            samplesPerPeak *= levelRatio;
+        }
+
+        const auto& level = levels[(size_t) levelIndex][(size_t) channel];
+        const auto numPeaks = (int64) level.min.size();
+        const auto peaksPerPixel = samplesPerPixel / samplesPerPeak;
+        const auto firstPeak = time.getStart() * sampleRate / samplesPerPeak;
+        const auto centreY = (float) area.getCentreY();
+        const auto halfHeight = area.getHeight() * 0.5f * gain;
+
+        RectangleList<float> peaks, rms;
+
+        for (int x = 0; x < area.getWidth(); ++x)
+        {
+            const auto columnStart = firstPeak + x * peaksPerPixel;
+            const auto columnEnd = columnStart + peaksPerPixel;
+
+            if (columnEnd <= 0.0 || columnStart >= (double) numPeaks)
+                continue;
+
+            const auto start = jmax ((int64) 0, (int64) columnStart);
+            const auto end = jmin (numPeaks, jmax (start + 1, (int64) columnEnd));
+
+            auto lo = level.min[(size_t) start], hi = level.max[(size_t) start], meanSquare = 0.0f;
+
+            for (auto i = start; i < end; ++i)
+            {
+                lo = jmin (lo, level.min[(size_t) i]);
+                hi = jmax (hi, level.max[(size_t) i]);
+                meanSquare += level.meanSquare[(size_t) i];
+            }
+
+            const auto r = std::sqrt (meanSquare / (float) (end - start));
+            const auto left = (float) (area.getX() + x);
+
+            peaks.addWithoutMerging ({ left, centreY - jlimit (-1.0f, 1.0f, hi) * halfHeight,
+                                       1.0f, jmax (1.0f, (hi - lo) * halfHeight) });
+            rms.addWithoutMerging ({ left, centreY - jmin (1.0f, r) * halfHeight,
+                                     1.0f, jmin (1.0f, r) * halfHeight * 2.0f });
+        }
+
+        g.fillRectList (peaks);
+
+        // The RMS body is drawn over the peaks in the same colour, so it reads darker
+        g.fillRectList (rms);
+        return true;
+    }
+
+    //==============================================================================
+    /** Any thread but the message thread. Loads the saved pyramid, or builds and saves
+        it if there isn't an up-to-date one. Returns false if the file can't be read
+        or shouldStop returned true part way through.
+    */
+    bool loadOrBuild (AudioFormatManager& formatManager, const std::function<bool()>& shouldStop)
+    {
+        // Taken before reading, so a write part way through the build shows up as a mismatch
+        fileSize = file.getSize();
+        fileModificationTime = file.getLastModificationTime().toMilliseconds();
+
+        const auto ok = load (getPeakFile (false)) || load (getPeakFile (true)) || build (formatManager, shouldStop);
+
+        if (ok)
+            ready.store (true, std::memory_order_release);
+        else
+            failed.store (true, std::memory_order_release);
+
+        sendChangeMessage();
+        return ok;
+    }
+
+private:
+    //==============================================================================
+    struct ChannelLevel
+    {
+        std::vector<float> min, max, meanSquare;
+    };
+
+    File file;
+    int64 fileSize = 0, fileModificationTime = 0;
+    int numChannels = 0;
+    double sampleRate = 44100.0;
+    std::vector<std::vector<ChannelLevel>> levels;  // [level][channel]
+    std::atomic<bool> ready { false }, failed { false };
+
+    static constexpr int fileMagic = 0x59504b50;    // "PKPY"
+    static constexpr int fileVersion = 1;
+    static constexpr int maxChannels = 64, maxLevels = 32;
+
+    // Saved next to the media if possible, otherwise in the temp folder
+    File getPeakFile (bool inTempFolder) const
+    {
+        if (! inTempFolder)
+            return file.getSiblingFile (file.getFileName() + ".peaks");
+
+        return File::getSpecialLocation (File::tempDirectory).getChildFile ("peaks")
+                   .getChildFile (String::toHexString (file.getFullPathName().hashCode64()) + ".peaks");
+    }
+
+    //==============================================================================
+    bool build (AudioFormatManager& formatManager, const std::function<bool()>& shouldStop)
+    {
+        std::unique_ptr<AudioFormatReader> reader (formatManager.createReaderFor (file));
+
+        if (reader == nullptr || reader->lengthInSamples <= 0 || reader->numChannels == 0)
+            return false;
+
+        numChannels = (int) reader->numChannels;
+        sampleRate = reader->sampleRate;
+
+        const auto numBasePeaks = (size_t) ((reader->lengthInSamples + baseSamplesPerPeak - 1) / baseSamplesPerPeak);
+        std::vector<ChannelLevel> base ((size_t) numChannels);
+
+        for (auto& c : base)
+        {
+            c.min.resize (numBasePeaks);
+            c.max.resize (numBasePeaks);
+            c.meanSquare.resize (numBasePeaks);
+        }
+
+        // Read in large blocks, each reduced a peak at a time with the vectorised min/max
+        constexpr int peaksPerBlock = 256;
+        AudioBuffer<float> block (numChannels, baseSamplesPerPeak * peaksPerBlock);
+
+        for (size_t peak = 0; peak < numBasePeaks; peak += peaksPerBlock)
+        {
+            if (shouldStop())
+                return false;
+
+            const auto startSample = (int64) peak * baseSamplesPerPeak;
+            const auto numSamples = (int) jmin ((int64) block.getNumSamples(), reader->lengthInSamples - startSample);
+            reader->read (&block, 0, numSamples, startSample, true, true);
+
+            for (int c = 0; c < numChannels; ++c)
+            {
+                const auto* samples = block.getReadPointer (c);
+                auto& level = base[(size_t) c];
+
+                for (int offset = 0, i = 0; offset < numSamples; offset += baseSamplesPerPeak, ++i)
+                {
+                    const auto n = jmin (baseSamplesPerPeak, numSamples - offset);
+                    const auto range = FloatVectorOperations::findMinAndMax (samples + offset, n);
+
+                    float sumOfSquares = 0.0f;
+
+                    for (int s = 0; s < n; ++s)
+                        sumOfSquares += samples[offset + s] * samples[offset + s];
+
+                    level.min[peak + (size_t) i] = range.getStart();
+                    level.max[peak + (size_t) i] = range.getEnd();
+                    level.meanSquare[peak + (size_t) i] = sumOfSquares / (float) n;
+                }
+            }
+        }
+
+        levels.clear();
+        levels.push_back (std::move (base));
+
+        // Each level is reduced straight from the base, so the runs get longer
+        // (and the vectorised reductions pay off more) the coarser the level
+        for (size_t run = levelRatio; run < numBasePeaks; run *= levelRatio)
+        {
+            const auto& source = levels.front();
+            const auto numPeaks = (numBasePeaks + run - 1) / run;
+            std::vector<ChannelLevel> level ((size_t) numChannels);
+
+            for (int c = 0; c < numChannels; ++c)
+            {
+                auto& dest = level[(size_t) c];
+                const auto& src = source[(size_t) c];
+                dest.min.resize (numPeaks);
+                dest.max.resize (numPeaks);
+                dest.meanSquare.resize (numPeaks);
+
+                for (size_t i = 0; i < numPeaks; ++i)
+                {
+                    const auto start = i * run;
+                    const auto n = (int) jmin (run, numBasePeaks - start);
+
+                    dest.min[i] = FloatVectorOperations::findMinimum (src.min.data() + start, n);
+                    dest.max[i] = FloatVectorOperations::findMaximum (src.max.data() + start, n);
+                    dest.meanSquare[i] = std::accumulate (src.meanSquare.begin() + (ptrdiff_t) start,
+                                                          src.meanSquare.begin() + (ptrdiff_t) start + n, 0.0f) / (float) n;
+                }
+            }
+
+            levels.push_back (std::move (level));
+        }
+
+        if (! save (getPeakFile (false)))
+            save (getPeakFile (true));
+
+        return true;
+    }
+
+    //==============================================================================
+    // The header records the file's size and modification time, so a changed file is rebuilt
+    bool save (const File& peakFile) const
+    {
+        if (! peakFile.getParentDirectory().createDirectory())
+            return false;
+
+        TemporaryFile temp (peakFile);
+
+        {
+            FileOutputStream out (temp.getFile());
+
+            if (out.failedToOpen())
+                return false;
+
+            out.writeInt (fileMagic);
+            out.writeInt (fileVersion);
+            out.writeInt64 (fileSize);
+            out.writeInt64 (fileModificationTime);
+            out.writeInt (numChannels);
+            out.writeDouble (sampleRate);
+            out.writeInt ((int) levels.size());
+
+            for (auto& level : levels)
+            {
+                out.writeInt64 ((int64) level.front().min.size());
+
+                for (auto& c : level)
+                    for (auto* values : { &c.min, &c.max, &c.meanSquare })
+                        out.write (values->data(), values->size() * sizeof (float));
+            }
+
+            out.flush();
+
+            if (out.getStatus().failed())
+                return false;
+        }
+
+        return temp.overwriteTargetFileWithTemporary();
+    }
+
+    bool load (const File& peakFile)
+    {
+        FileInputStream in (peakFile);
+
+        if (in.failedToOpen()
+             || in.readInt() != fileMagic
+             || in.readInt() != fileVersion
+             || in.readInt64() != fileSize
+             || in.readInt64() != fileModificationTime)
+            return false;
+
+        numChannels = in.readInt();
+        sampleRate = in.readDouble();
+        const auto numLevels = in.readInt();
+
+        if (! isPositiveAndNotGreaterThan (numChannels, maxChannels)
+             || ! isPositiveAndNotGreaterThan (numLevels, maxLevels)
+             || ! (sampleRate > 0.0))
+            return false;
+
+        levels.assign ((size_t) numLevels, std::vector<ChannelLevel> ((size_t) numChannels));
+        int64 numBasePeaks = 0;
+
+        for (size_t levelIndex = 0; levelIndex < levels.size(); ++levelIndex)
+        {
+            // A corrupt or foreign file mustn't be able to ask for more than it holds, and
+            // each level has to be the size build() would have made it
+            const auto numPeaks = in.readInt64();
+            const auto bytesPerPeak = numChannels * 3 * (int64) sizeof (float);
+
+            if (levelIndex == 0)
+                numBasePeaks = numPeaks;
+
+            int64 run = 1;
+
+            for (size_t i = 0; i < levelIndex; ++i)
+                run *= levelRatio;
+
+            if (numPeaks <= 0 || numPeaks != (numBasePeaks + run - 1) / run
+                 || numPeaks > in.getNumBytesRemaining() / bytesPerPeak)
+                return false;
+
+            for (auto& c : levels[levelIndex])
+            {
+                for (auto* values : { &c.min, &c.max, &c.meanSquare })
+                {
+                    values->resize ((size_t) numPeaks);
+                    const auto numBytes = (int) (numPeaks * sizeof (float));
+
+                    if (in.read (values->data(), numBytes) != numBytes)
+                        return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (PeakPyramid)
+};
+
+//==============================================================================
+/**
+    Hands out one PeakPyramid per file and builds them on a background thread.
+    Get at it through a SharedResourcePointer<PeakPyramidCache>.
+*/
+class PeakPyramidCache
+{
+public:
+    PeakPyramidCache()
+    {
+        formatManager.registerBasicFormats();
+    }
+
+    ~PeakPyramidCache()
+    {
+        pool.removeAllJobs (true, 5000);
+    }
+
+    /** Message thread. Returns the file's pyramid, starting a build if needed.
+        Listen to it to find out when it's ready.
+    */
+    PeakPyramid::Ptr getPyramid (const File& file)
+    {
+        if (file == File())
+            return {};
+
+        purgeUnused();
+
+        const auto key = file.getFullPathName();
+        auto& pyramid = pyramids[key];
+
+        // A failed build (say of a proxy that hadn't been written yet) is tried again,
+        // and so is one of a file that has been rewritten since
+        if (pyramid == nullptr || pyramid->hasFailed() || (pyramid->isReady() && ! pyramid->matchesFile()))
+        {
+            pyramid = new PeakPyramid (file);
+
+            pool.addJob (new BuildJob (pyramid, formatManager), true);
+        }
+
+        return pyramid;
+    }
+
+private:
+    struct BuildJob  : public ThreadPoolJob
+    {
+        BuildJob (PeakPyramid::Ptr p, AudioFormatManager& fm)
+            : ThreadPoolJob ("Peak pyramid"), pyramid (p), formatManager (fm)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            pyramid->loadOrBuild (formatManager, [this] { return shouldExit(); });
+            return jobHasFinished;
+        }
+
+        PeakPyramid::Ptr pyramid;
+        AudioFormatManager& formatManager;
+    };
+
+    AudioFormatManager formatManager;
+    ThreadPool pool { 1 };
+    std::map<String, PeakPyramid::Ptr> pyramids;
+
+    void purgeUnused()
+    {
+        for (auto i = pyramids.begin(); i != pyramids.end();)
+            i = i->second->getReferenceCount() == 1 ? pyramids.erase (i) : std::next (i);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (PeakPyramidCache)
+};
@@ -0,0 +1,292 @@
+#pragma once
+
+#include "Utilities.h"
+
+//==============================================================================
+/**
+    A cached copy of an Edit's tempo map for fast beats/bars <-> time conversion.
+
+    The map is held as a sorted array of segments, one per tempo change, each
+    with a closed-form conversion (constant tempo, or a linear BPM ramp between
+    two points). Lookups are a binary search plus a couple of flops, and can be
+    made from any thread without locking.
+
+    Changes to the TempoSequence are picked up through its ValueTree. Only the
+    segments from the first changed tempo onwards are rebuilt, into the inactive
+    half of a double buffer that is then published with an atomic flip. Readers
+    check a sequence number and retry in the rare case a flip happened mid-read.
+    The message thread brings the index up to date before reading, other threads
+    see the last published version.
+*/
+class TempoMapIndex  : private ValueTree::Listener,
+                       private AsyncUpdater
+{
+public:
+    TempoMapIndex (te::TempoSequence& ts)
+        : tempoSequence (ts)
+    {
+        rebuild (0);
+        tempoSequence.state.addListener (this);
+    }
+
+    ~TempoMapIndex() override
+    {
+        tempoSequence.state.removeListener (this);
+        cancelPendingUpdate();
+    }
+
+    //==============================================================================
+    double beatsToTime (double beats)
+    {
+        return read ([beats] (const Table& t) { return t.getTempoSegmentForBeat (beats).beatsToTime (beats); });
+    }
+
+    double timeToBeats (double time)
+    {
+        return read ([time] (const Table& t) { return t.getTempoSegmentForTime (time).timeToBeats (time); });
+    }
+
+    double barsBeatsToBeats (te::TempoSequence::BarsAndBeats bb)
+    {
+        return read ([bb] (const Table& t) { return t.getBarSegmentForBar (bb.bars).toBeats (bb.bars, bb.beats); });
+    }
+
+    double barsBeatsToTime (te::TempoSequence::BarsAndBeats bb)
+    {
+        return beatsToTime (barsBeatsToBeats (bb));
+    }
+
+    double getBpmAt (double beats)
+    {
+        return read ([beats] (const Table& t) { return t.getTempoSegmentForBeat (beats).getBpmAt (beats); });
+    }
+
+    /** Message thread only. Applies any pending change straight away. */
+    void updateIfNeeded()
+    {
+        if (firstDirtyTempo < std::numeric_limits<int>::max())
+        {
+            cancelPendingUpdate();
+            handleAsyncUpdate();
+        }
+    }
+
+    /** Changes every time a new version of the map is published. */
+    uint32 getVersion() const noexcept      { return version.load (std::memory_order_acquire); }
+
+    static constexpr int maxTempoSegments = 512;
+    static constexpr int maxBarSegments = 128;
+
+private:
+    //==============================================================================
+    struct TempoSegment
+    {
+        double startBeat = 0.0, startTime = 0.0, startBpm = 120.0;
+        double bpmPerBeat = 0.0;    // Zero for a constant tempo
+
+        double getBpmAt (double beats) const noexcept
+        {
+            return startBpm + bpmPerBeat * (beats - startBeat);
+        }
+
+        double beatsToTime (double beats) const noexcept
+        {
+            const auto delta = beats - startBeat;
+
+            if (std::abs (bpmPerBeat) < 1.0e-9)
+                return startTime + delta * 60.0 / startBpm;
+
+            // Integral of 60 / (startBpm + k * b) db
+            return startTime + 60.0 / bpmPerBeat * std::log ((startBpm + bpmPerBeat * delta) / startBpm);
+        }
+
+        double timeToBeats (double time) const noexcept
+        {
+            const auto delta = time - startTime;
+
+            if (std::abs (bpmPerBeat) < 1.0e-9)
+                return startBeat + delta * startBpm / 60.0;
+
+            return startBeat + startBpm * (std::exp (bpmPerBeat * delta / 60.0) - 1.0) / bpmPerBeat;
+        }
+    };
+
+    struct BarSegment
+    {
+        double startBeat = 0.0;
+        int startBar = 0, beatsPerBar = 4;
+
+        double toBeats (int bars, double beats) const noexcept
+        {
+            return startBeat + (bars - startBar) * beatsPerBar + beats;
+        }
+    };
+
+    // Fixed size so a reader that's about to be told to retry can never touch freed memory
+    struct Table
+    {
+        std::array<TempoSegment, maxTempoSegments> tempos;
+        std::array<BarSegment, maxBarSegments> bars;
+        int numTempos = 1, numBars = 1;
+
+        const TempoSegment& getTempoSegmentForBeat (double beats) const noexcept
+        {
+            auto end = tempos.begin() + numTempos;
+            auto i = std::upper_bound (tempos.begin() + 1, end, beats,
+                                       [] (double b, const TempoSegment& s) { return b < s.startBeat; });
+            return *(i - 1);
+        }
+
+        const TempoSegment& getTempoSegmentForTime (double time) const noexcept
+        {
+            auto end = tempos.begin() + numTempos;
+            auto i = std::upper_bound (tempos.begin() + 1, end, time,
+                                       [] (double t, const TempoSegment& s) { return t < s.startTime; });
+            return *(i - 1);
+        }
+
+        const BarSegment& getBarSegmentForBar (int bar) const noexcept
+        {
+            auto end = bars.begin() + numBars;
+            auto i = std::upper_bound (bars.begin() + 1, end, bar,
+                                       [] (int b, const BarSegment& s) { return b < s.startBar; });
+            return *(i - 1);
+        }
+    };
+
+    te::TempoSequence& tempoSequence;
+    Table tables[2];
+    std::atomic<int> activeTable { 0 };
+    std::atomic<uint32> version { 0 };
+    int firstDirtyTempo = std::numeric_limits<int>::max();
+
+    //==============================================================================
+    template <typename Function>
+    double read (Function&& f)
+    {
+        if (MessageManager::existsAndIsCurrentThread())
+            updateIfNeeded();
+
+        for (;;)
+        {
+            const auto before = version.load (std::memory_order_acquire);
+            const auto result = f (tables[activeTable.load (std::memory_order_acquire)]);
+            std::atomic_thread_fence (std::memory_order_acquire);
+
+            if (version.load (std::memory_order_relaxed) == before)
+                return result;
+        }
+    }
+
+    // Rebuilds every tempo segment from firstTempo on, copying the rest from the live table
+    void rebuild (int firstTempo)
+    {
+        const auto& live = tables[activeTable.load (std::memory_order_relaxed)];
+        auto& next = tables[1 - activeTable.load (std::memory_order_relaxed)];
+
+        // Bumped before writing as well, so a reader still on this table always retries
+        version.fetch_add (1, std::memory_order_acq_rel);
+
+        auto tempos = tempoSequence.getTempos();
+        const auto numTempos = jlimit (1, maxTempoSegments, tempos.size());
+        jassert (tempos.size() <= maxTempoSegments);
+
+        // The segment before the change ramps towards it, so that one needs redoing too
+        firstTempo = jlimit (0, jmin (live.numTempos, numTempos), firstTempo - 1);
+        std::copy (live.tempos.begin(), live.tempos.begin() + firstTempo, next.tempos.begin());
+
+        for (int i = firstTempo; i < numTempos; ++i)
+        {
+            auto& seg = next.tempos[(size_t) i];
+
+            if (auto t = tempos[i])
+            {
+                seg.startBeat = i == 0 ? 0.0 : t->getStartBeat();
+                seg.startBpm = t->getBpm();
+                seg.bpmPerBeat = 0.0;
+
+                // Anchoring each segment on the engine's own conversion keeps any
+                // rounding from building up across segments
+                seg.startTime = tempoSequence.beatsToTime (seg.startBeat);
+
+                if (i + 1 < numTempos && std::abs (t->getCurve()) < 1.0f)
+                    if (auto nextTempo = tempos[i + 1])
+                        if (auto length = nextTempo->getStartBeat() - seg.startBeat; length > 0.0)
+                            seg.bpmPerBeat = (nextTempo->getBpm() - seg.startBpm) / length;
+            }
+        }
+
+        next.numTempos = numTempos;
+
+        // Time signatures are few and cheap, so they're always redone
+        auto timeSigs = tempoSequence.getTimeSigs();
+        next.numBars = jlimit (1, maxBarSegments, timeSigs.size());
+        jassert (timeSigs.size() <= maxBarSegments);
+
+        for (int i = 0; i < next.numBars; ++i)
+        {
+            auto& seg = next.bars[(size_t) i];
+
+            if (auto sig = timeSigs[i])
+            {
+                seg.startBeat = i == 0 ? 0.0 : sig->getStartBeat();
+                seg.beatsPerBar = jmax (1, sig->numerator.get());
+
+                if (i == 0)
+                {
+                    seg.startBar = 0;
+                }
+                else
+                {
+                    auto& prev = next.bars[(size_t) i - 1];
+                    seg.startBar = prev.startBar + roundToInt (std::ceil ((seg.startBeat - prev.startBeat) / prev.beatsPerBar));
+                }
+            }
+        }
+
+        activeTable.store (1 - activeTable.load (std::memory_order_relaxed), std::memory_order_release);
+        version.fetch_add (1, std::memory_order_release);
+    }
+
+    int getTempoIndex (const ValueTree& v) const
+    {
+        int index = 0;
+
+        for (auto child : tempoSequence.state)
+        {
+            if (child == v)
+                return index;
+
+            if (child.hasType (te::IDs::TEMPO))
+                ++index;
+        }
+
+        return 0;
+    }
+
+    void markDirty (const ValueTree& v)
+    {
+        firstDirtyTempo = jmin (firstDirtyTempo, v.hasType (te::IDs::TEMPO) ? getTempoIndex (v) : 0);
+        triggerAsyncUpdate();
+    }
+
+    void handleAsyncUpdate() override
+    {
+        const auto first = std::exchange (firstDirtyTempo, std::numeric_limits<int>::max());
+
+        if (first < std::numeric_limits<int>::max())
+            rebuild (first);
+    }
+
+    void valueTreePropertyChanged (ValueTree& v, const Identifier&) override
+    {
+        if (v.hasType (te::IDs::TEMPO) || v.hasType (te::IDs::TIMESIG))
+            markDirty (v);
+    }
+
+    void valueTreeChildAdded (ValueTree&, ValueTree& c) override           { markDirty (c); }
+    void valueTreeChildRemoved (ValueTree&, ValueTree& c, int) override    { markDirty (c); }
+    void valueTreeChildOrderChanged (ValueTree& p, int, int) override      { markDirty (p); }
+
+    JUCE_DECLARE_NON_COPYABLE (TempoMapIndex)
+};
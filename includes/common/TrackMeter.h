@@ -0,0 +1,137 @@
+#pragma once
+
+#include "Utilities.h"
+
+//==============================================================================
+/**
+    The level and plugin load of one audio track, read on the message thread.
+
+    Nothing is added to the Edit to measure it, so it only sees what tracktion
+    already measures:
+    - The peak comes from a client on the track's own LevelMeterPlugin, which
+      holds it until the next reading so a transient between two frames still
+      shows. The measurer only gives one kind of level per client and its mode
+      is shared with every other reader, so there's no RMS. averagePeak, the
+      peaks smoothed over about 300ms, stands in for the body of the signal.
+    - The plugin load is the sum of the time each of the track's plugins spent
+      in its own render call, as a share of the block. Other tracks' nodes
+      running in between aren't counted, and nor are the track's clip and
+      input nodes. tracktion smooths it over a few blocks, so a single slow
+      block isn't seen; heldPluginLoad is the highest reading of the last
+      second or so.
+*/
+class TrackMeter  : public ReferenceCountedObject
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<TrackMeter>;
+
+    struct Reading
+    {
+        float peak = 0.0f, averagePeak = 0.0f;
+        float pluginLoad = 0.0f, heldPluginLoad = 0.0f;    // Of the block's budget
+    };
+
+    explicit TrackMeter (te::AudioTrack& t)  : track (&t) {}
+
+    ~TrackMeter() override
+    {
+        attachTo (nullptr);
+    }
+
+    //==============================================================================
+    /** Message thread. Takes the peaks since the last reading, so only one view should call it. */
+    Reading takeReading()
+    {
+        auto at = dynamic_cast<te::AudioTrack*> (track.get());
+        attachTo (at != nullptr ? at->getLevelMeterPlugin() : nullptr);
+
+        Reading r;
+
+        if (levelMeter != nullptr)
+            for (int ch = 0; ch < 2; ++ch)
+                r.peak = jmax (r.peak, Decibels::decibelsToGain (client.getAndClearAudioLevel (ch).dB));
+
+        // The same time constants whatever the frame rate
+        const auto now = Time::getMillisecondCounterHiRes();
+        const auto elapsedMs = lastReadingMs > 0.0 ? now - lastReadingMs : 0.0;
+        lastReadingMs = now;
+
+        smoothedPeak += (r.peak - smoothedPeak) * (elapsedMs > 0.0 ? (float) (1.0 - std::exp (-elapsedMs / 300.0)) : 1.0f);
+        r.averagePeak = smoothedPeak;
+
+        r.pluginLoad = getPluginLoad();
+        heldPluginLoad = jmax (r.pluginLoad, heldPluginLoad * (float) std::exp (-elapsedMs / 1000.0));
+        r.heldPluginLoad = heldPluginLoad;
+        return r;
+    }
+
+    /** Message thread. The share of the block budget the track's plugins are taking,
+        already smoothed by tracktion.
+    */
+    float getPluginLoad() const
+    {
+        float load = 0.0f;
+
+        if (auto at = dynamic_cast<te::AudioTrack*> (track.get()))
+            for (auto p : at->pluginList)
+                load += (float) p->getCpuUsage();
+
+        return load;
+    }
+
+private:
+    te::Selectable::WeakRef track;
+
+    // Held so the measurer is still there to take the client off, even after the
+    // plugin has left the track
+    te::Plugin::Ptr levelMeter;
+    te::LevelMeasurer::Client client;
+
+    float smoothedPeak = 0.0f, heldPluginLoad = 0.0f;
+    double lastReadingMs = 0.0;
+
+    void attachTo (te::LevelMeterPlugin* newMeter)
+    {
+        if (levelMeter.get() == newMeter)
+            return;
+
+        if (auto old = dynamic_cast<te::LevelMeterPlugin*> (levelMeter.get()))
+            old->measurer.removeClient (client);
+
+        levelMeter = newMeter;
+        client.reset();
+
+        if (newMeter != nullptr)
+            newMeter->measurer.addClient (client);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TrackMeter)
+};
+
+//==============================================================================
+/**
+    Finds the TrackMeter for a track, so the views that show it share one. Get at
+    it through a SharedResourcePointer<TrackMeterRegistry>. Message thread only.
+*/
+class TrackMeterRegistry
+{
+public:
+    TrackMeter::Ptr getMeterFor (te::AudioTrack& t)
+    {
+        auto& meter = meters[t.itemID.getRawID()];
+
+        if (meter == nullptr)
+            meter = new TrackMeter (t);
+
+        return meter;
+    }
+
+    /** Called when a track leaves the Edit. Views still holding its meter keep it until they go. */
+    void removeMeterFor (te::EditItemID trackID)
+    {
+        meters.erase (trackID.getRawID());
+    }
+
+private:
+    std::unordered_map<uint64, TrackMeter::Ptr> meters;
+};
@@ -8,6 +8,7 @@
 
 #pragma once
 #include <JuceHeader.h>
+#include "FrameClock.h"
 
 namespace te = tracktion_engine;
 using namespace juce;
@@ -259,12 +260,72 @@ namespace EngineHelpers
 
 }
 
+//==============================================================================
+class FlaggedAsyncUpdater;
+
+/**
+    Holds back the updates of the edit view's components while a bulk edit runs.
+
+    Each tree change a component hears about only sets one of its flags, so a
+    paste of a thousand notes or a template load still means thousands of
+    listener callbacks, and updates can run part way through if the operation
+    spans more than one message. Wrap the operation in a ScopedTransaction and
+    every FlaggedAsyncUpdater marked inside it is collected, once however many
+    times it's marked. When the outermost transaction ends each one gets a
+    single update, in the order they were first marked, with its flags saying
+    everything that changed.
+
+    Message thread only. Transactions can nest.
+*/
+class ChangeBatch
+{
+public:
+    struct ScopedTransaction
+    {
+        ScopedTransaction()     { ++depth; }
+        ~ScopedTransaction()    { if (--depth == 0) dispatch(); }
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedTransaction)
+    };
+
+    static bool isOpen() noexcept       { return depth > 0; }
+
+private:
+    friend class FlaggedAsyncUpdater;
+
+    static inline int depth = 0;
+    static inline Array<FlaggedAsyncUpdater*> pending;
+
+    static bool defer (FlaggedAsyncUpdater& u)
+    {
+        JUCE_ASSERT_MESSAGE_THREAD
+
+        if (! isOpen())
+            return false;
+
+        pending.addIfNotAlreadyThere (&u);
+        return true;
+    }
+
+    static void forget (FlaggedAsyncUpdater& u)     { pending.removeFirstMatchingValue (&u); }
+
+    static inline void dispatch();
+};
+
 //==============================================================================
 class FlaggedAsyncUpdater : public AsyncUpdater
 {
 public:
+    ~FlaggedAsyncUpdater() override     { ChangeBatch::forget (*this); }
+
     //==============================================================================
-    void markAndUpdate (bool& flag)     { flag = true; triggerAsyncUpdate(); }
+    void markAndUpdate (bool& flag)
+    {
+        flag = true;
+
+        if (! ChangeBatch::defer (*this))
+            triggerAsyncUpdate();
+    }
     
     bool compareAndReset (bool& flag) noexcept
     {
@@ -274,29 +335,45 @@ public:
         flag = false;
         return true;
     }
+
+private:
+    friend class ChangeBatch;
+
+    void dispatchNow()
+    {
+        cancelPendingUpdate();
+        handleAsyncUpdate();
+    }
 };
 
+// An update may delete other components that are still waiting, which takes them
+// out of the list, or mark new ones, which now go through the normal async path
+void ChangeBatch::dispatch()
+{
+    while (! pending.isEmpty())
+        pending.removeAndReturn (0)->dispatchNow();
+}
+
 //==============================================================================
-struct Thumbnail    : public Component
+struct Thumbnail    : public Component,
+                      private FrameClock::Client
 {
     Thumbnail (te::TransportControl& tc)
         : transport (tc)
     {
-        cursorUpdater.setCallback ([this]
-                                   {
-                                       updateCursorPosition();
-
-                                       if (smartThumbnail.isGeneratingProxy() || smartThumbnail.isOutOfDate())
-                                           repaint();
-                                   });
         cursor.setFill (findColour (Label::textColourId));
         addAndMakeVisible (cursor);
     }
 
+    ~Thumbnail() override
+    {
+        frameClock->removeClient (this);
+    }
+
     void setFile (const te::AudioFile& file)
     {
         smartThumbnail.setNewFile (file);
-        cursorUpdater.startTimerHz (25);
+        frameClock->addClient (this);
         repaint();
     }
 
@@ -342,15 +419,32 @@ private:
     te::TransportControl& transport;
     te::SmartThumbnail smartThumbnail { transport.engine, te::AudioFile (transport.engine), *this, nullptr };
     DrawableRectangle cursor;
-    te::LambdaTimer cursorUpdater;
+    SharedResourcePointer<FrameClock> frameClock;
+    float cursorX = -1.0f;
+
+    bool updateFrame (FrameClock::Frame& frame) override
+    {
+        const bool isBusy = smartThumbnail.isGeneratingProxy() || smartThumbnail.isOutOfDate();
+
+        if (isBusy)
+            repaint();
 
-    void updateCursorPosition()
+        return updateCursorPosition (frame.getPosition (transport)) || isBusy;
+    }
+
+    bool updateCursorPosition (double position)
     {
         const double loopLength = transport.getLoopRange().getLength();
-        const double proportion = loopLength == 0.0 ? 0.0 : transport.getCurrentPosition() / loopLength;
+        const double proportion = loopLength == 0.0 ? 0.0 : position / loopLength;
 
         auto r = getLocalBounds().toFloat();
         const float x = r.getWidth() * float (proportion);
+
+        if (x == cursorX)
+            return false;
+
+        cursorX = x;
         cursor.setRectangle (r.withWidth (2.0f).withX (x));
+        return true;
     }
 };